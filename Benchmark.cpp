@@ -0,0 +1,232 @@
+// Benchmark.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Benchmark.hpp"
+#include "CPUClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+Benchmark::Sample Benchmark::sample() const
+{
+  Sample result;
+  result.mTime = CPUClock::now();
+
+  std::ifstream      in(mPath + "/cpu.stat");
+  std::ostringstream text;
+  text << in.rdbuf();
+  try {
+    parse_cpu_stat(text.str(), result);
+  }
+  catch (std::invalid_argument const&) {
+    throw std::runtime_error("Cannot read " + mPath + "/cpu.stat");
+  }
+  return result;
+}
+
+void Benchmark::add(int config, Sample const& from, Sample const& to)
+{
+  Sample run;
+  run.mTime   = to.mTime - from.mTime;
+  run.mUsage  = to.mUsage - from.mUsage;
+  run.mUser   = to.mUser - from.mUser;
+  run.mSystem = to.mSystem - from.mSystem;
+  mRuns[config].push_back(run);
+}
+
+// Return the values of field of runs.
+static std::vector<double> column(std::vector<Benchmark::Sample> const& runs,
+                                  double Benchmark::Sample::*field)
+{
+  std::vector<double> result;
+  for (Benchmark::Sample const& run : runs)
+    result.push_back(run.*field);
+  return result;
+}
+
+std::string Benchmark::report() const
+{
+  static struct
+  {
+    char const* mName;
+    double Sample::*mField;
+  } const metrics[] = {{"wall", &Sample::mTime},
+                       {"cpu", &Sample::mUsage},
+                       {"user", &Sample::mUser},
+                       {"system", &Sample::mSystem}};
+
+  bool        ab = !mRuns[0].empty() && !mRuns[1].empty();
+  std::string result;
+  char        buffer[128];
+  for (int config = 0; config < 2; ++config) {
+    if (mRuns[config].empty())
+      continue;
+    std::snprintf(buffer, sizeof(buffer),
+                  "%s%zu runs, times in s:\n%-13s%11s %11s %11s %11s  %s\n",
+                  ab ? (config ? "B: " : "A: ") : "", mRuns[config].size(),
+                  "", "mean", "median", "+-95% CI", "stddev", "outliers");
+    result += buffer;
+    for (auto const& metric : metrics) {
+      Summary summary = summarize(column(mRuns[config], metric.mField));
+      std::snprintf(buffer, sizeof(buffer),
+                    "  %-10s %11.6f %11.6f %11.6f %11.6f  %zu\n",
+                    metric.mName, summary.mMean, summary.mMedian, summary.mCI,
+                    summary.mStdDev, summary.mOutliers.size());
+      result += buffer;
+    }
+  }
+
+  if (ab && (mRuns[0].size() > 1) && (mRuns[1].size() > 1)) {
+    result += "B - A:\n";
+    for (auto const& metric : metrics) {
+      std::vector<double> a = column(mRuns[0], metric.mField);
+      Comparison          c = compare(a, column(mRuns[1], metric.mField));
+      Summary             s = summarize(a);
+      std::snprintf(buffer, sizeof(buffer), "  %-10s %+11.6f +- %.6f s",
+                    metric.mName, c.mDifference, c.mCI);
+      result += buffer;
+      if (s.mMean > 0.0) {
+        std::snprintf(buffer, sizeof(buffer), " (%+.2f%% +- %.2f%%)",
+                      100.0 * c.mDifference / s.mMean,
+                      100.0 * c.mCI / s.mMean);
+        result += buffer;
+      }
+      result += c.mSignificant ? ", significant\n" : ", not significant\n";
+    }
+  }
+  return result;
+}
+
+void Benchmark::parse_cpu_stat(std::string const& text, Sample& sample)
+{
+  // Each line is a key followed by a value, e.g.
+  //   usage_usec 1234
+  // Only the first three are guaranteed to exist without the cpu controller.
+  int                found = 0;
+  std::istringstream in(text);
+  std::string        key;
+  for (double value; in >> key >> value;) {
+    if ("usage_usec" == key)
+      sample.mUsage = value / 1e6;
+    else if ("user_usec" == key)
+      sample.mUser = value / 1e6;
+    else if ("system_usec" == key)
+      sample.mSystem = value / 1e6;
+    else
+      continue;
+    ++found;
+  }
+  if (3 != found)
+    throw std::invalid_argument("Incomplete cpu.stat data");
+}
+
+// Return the q quantile of sorted, interpolating between its values.
+static double quantile(std::vector<double> const& sorted, double q)
+{
+  double pos   = q * (sorted.size() - 1);
+  size_t index = (size_t)pos;
+  if (index + 1 >= sorted.size())
+    return sorted.back();
+  return sorted[index] + (pos - index) * (sorted[index + 1] - sorted[index]);
+}
+
+Summary Benchmark::summarize(std::vector<double> const& values)
+{
+  Summary result;
+  result.mCount = values.size();
+  for (double value : values)
+    result.mMean += value;
+  result.mMean /= result.mCount;
+
+  std::vector<double> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  result.mMedian = quantile(sorted, 0.5);
+  if (result.mCount < 2)
+    return result;
+
+  double squares = 0.0;
+  for (double value : values)
+    squares += (value - result.mMean) * (value - result.mMean);
+  result.mStdDev = std::sqrt(squares / (result.mCount - 1));
+  result.mCI     = t_quantile(result.mCount - 1) * result.mStdDev /
+               std::sqrt((double)result.mCount);
+
+  // Tukey's fences: values more than 1.5 interquartile ranges outside the
+  // quartiles are outliers.
+  double q1  = quantile(sorted, 0.25);
+  double q3  = quantile(sorted, 0.75);
+  double iqr = q3 - q1;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if ((values[i] < q1 - 1.5 * iqr) || (values[i] > q3 + 1.5 * iqr))
+      result.mOutliers.push_back(i);
+  }
+  return result;
+}
+
+Comparison Benchmark::compare(std::vector<double> const& a,
+                              std::vector<double> const& b)
+{
+  Summary    sa = summarize(a);
+  Summary    sb = summarize(b);
+  Comparison result;
+  result.mDifference = sb.mMean - sa.mMean;
+
+  // Welch's t-test doesn't assume equal variances, and uses the
+  // Welch-Satterthwaite approximation for the degrees of freedom.
+  double va = sa.mStdDev * sa.mStdDev / sa.mCount;
+  double vb = sb.mStdDev * sb.mStdDev / sb.mCount;
+  if (va + vb > 0.0) {
+    double df = (va + vb) * (va + vb) /
+                (va * va / (sa.mCount - 1) + vb * vb / (sb.mCount - 1));
+    result.mCI = t_quantile(df) * std::sqrt(va + vb);
+  }
+  result.mSignificant = std::fabs(result.mDifference) > result.mCI;
+  return result;
+}
+
+double Benchmark::t_quantile(double df)
+{
+  static double const table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  int const size = sizeof(table) / sizeof(table[0]);
+
+  // Interpolate the table for the fractional degrees of freedom of Welch's
+  // t-test, and use the Cornish-Fisher expansion beyond it.
+  if (df <= 1.0)
+    return table[0];
+  if (df < size) {
+    int i = (int)df;
+    return table[i - 1] + (df - i) * (table[i] - table[i - 1]);
+  }
+  double z = 1.959964;
+  return z + (z * z * z + z) / (4.0 * df) +
+         (5.0 * std::pow(z, 5) + 16.0 * z * z * z + 3.0 * z) /
+             (96.0 * df * df);
+}
@@ -0,0 +1,105 @@
+// Benchmark.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <string>
+#include <vector>
+
+//! Summary statistics of a series of measurements.
+struct Summary
+{
+  size_t              mCount  = 0;
+  double              mMean   = 0.0;
+  double              mMedian = 0.0;
+  double              mStdDev = 0.0; //!< Sample standard deviation.
+  double              mCI     = 0.0; //!< Half width of the 95% CI of mMean.
+  std::vector<size_t> mOutliers;     //!< Indices outside Tukey's fences.
+};
+
+//! Difference of the means of two series, b - a, according to Welch's t-test.
+struct Comparison
+{
+  double mDifference  = 0.0;
+  double mCI          = 0.0; //!< Half width of the 95% CI of mDifference.
+  bool   mSignificant = false; //!< Whether the CI excludes 0.
+};
+
+//! Collect the wall and CPU time of the repeated runs of a command in a
+//! partition, in one or (for an A/B comparison) two configurations.
+class Benchmark
+{
+public:
+  //! Wall and CPU time in seconds, either cumulative or of a single run.
+  struct Sample
+  {
+    double mTime   = 0.0; //!< Monotonic wall time.
+    double mUsage  = 0.0; //!< cpu.stat usage_usec.
+    double mUser   = 0.0; //!< cpu.stat user_usec.
+    double mSystem = 0.0; //!< cpu.stat system_usec.
+  };
+
+protected:
+  std::string         mPath;
+  std::vector<Sample> mRuns[2];
+
+public:
+  //! Collect runs in the cgroup at path.
+  explicit Benchmark(std::string const& path) : mPath(path)
+  {
+  }
+
+  //! Read the current counters of the cgroup.
+  Sample sample() const;
+
+  //! Record the run of configuration config (0 or 1) between from and to.
+  void add(int config, Sample const& from, Sample const& to);
+
+  //! Return the number of runs recorded for configuration config.
+  size_t runs(int config) const
+  {
+    return mRuns[config].size();
+  }
+
+  //! Return a table of the statistics of each configuration, followed by the
+  //! comparison of the two if both have runs.
+  std::string report() const;
+
+  //! Parse the contents of a cpu.stat file into the CPU times of sample.
+  //! \throw std::invalid_argument if a time is missing.
+  static void parse_cpu_stat(std::string const& text, Sample& sample);
+
+  //! Return the summary statistics of values, which must not be empty.
+  static Summary summarize(std::vector<double> const& values);
+
+  //! Compare the means of a and b, which must have at least two values each.
+  static Comparison compare(std::vector<double> const& a,
+                            std::vector<double> const& b);
+
+  //! Return the 97.5% quantile of Student's t distribution with df degrees
+  //! of freedom.
+  static double t_quantile(double df);
+};
+
+#endif // Benchmark_hpp
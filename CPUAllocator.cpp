@@ -0,0 +1,287 @@
+// CPUAllocator.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "CPUAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+CPUAllocator::CPUAllocator(CPUTopology const& topology,
+                           AllocationPolicy   policy)
+  : mTopology(topology), mPolicy(policy), mNodes(0)
+{
+  // Group the CPUs into cores and the cores into last level cache domains
+  // once, so that allocate only has to look for the free CPUs. Since the
+  // topology's order lists CPUs sharing a core and cores sharing a cache next
+  // to each other, a single pass is sufficient.
+  int llc = -1, core = -1;
+  for (int cpu : topology.order()) {
+    CPUTopology::CPU const& info = topology[cpu];
+    if (mLLCs.empty() || (info.mLLC != llc)) {
+      mLLCs.push_back({info.mNode, mCores.size(), mCores.size(), CPUSet()});
+      llc  = info.mLLC;
+      core = -1;
+    }
+    if (info.mCore != core) {
+      mCores.push_back(mCPUs.size());
+      core               = info.mCore;
+      mLLCs.back().mLast = mCores.size();
+    }
+    mCPUs.push_back(cpu);
+    mLLCs.back().mSet.set(cpu);
+    mNodes = std::max(mNodes, info.mNode + 1);
+  }
+  mCores.push_back(mCPUs.size());
+
+  mFree.resize(mCPUs.size());
+  mFreeCores.resize(mCores.size() - 1);
+  mFreeLLCs.resize(mLLCs.size());
+  mNodeFree.resize(mNodes);
+  mOrder.reserve(mLLCs.size());
+}
+
+AllocationPolicy CPUAllocator::policy(std::string const& name)
+{
+  if ("linear" == name)
+    return AllocationPolicy::Linear;
+  else if ("compact" == name)
+    return AllocationPolicy::Compact;
+  else if ("spread" == name)
+    return AllocationPolicy::Spread;
+
+  throw std::invalid_argument("Unknown allocation policy '" + name + "'");
+}
+
+CPUSet CPUAllocator::allocate(CPUSet const& free, int count) const
+{
+  CPUSet result;
+  if ((count <= 0) || (count > free.count()))
+    return CPUSet();
+
+  if (AllocationPolicy::Linear == mPolicy) {
+    for (int cpu = free.first(); (cpu >= 0) && count; cpu = free.next(cpu)) {
+      if (mTopology.online(cpu)) {
+        result.set(cpu);
+        count -= 1;
+      }
+    }
+    if (count)
+      result.zero();
+    return result;
+  }
+
+  // Count the free CPUs of each last level cache, but only collect the free
+  // CPUs of its cores when taking CPUs from it. The free CPUs of a core are
+  // kept at the core's position in mCPUs.
+  std::vector<int>&    cpus      = mFree;
+  std::vector<Core>&   cores     = mFreeCores;
+  std::vector<Domain>& domains   = mFreeLLCs;
+  std::vector<int>&    node_free = mNodeFree;
+  std::fill(node_free.begin(), node_free.end(), 0);
+  for (size_t i = 0; i < mLLCs.size(); ++i) {
+    LLC const& llc = mLLCs[i];
+    domains[i] = {llc.mNode, llc.mFirst, llc.mLast, free.count(llc.mSet),
+                  false};
+    node_free[llc.mNode] += domains[i].mFree;
+  }
+
+  auto collect = [&](Domain& domain) {
+    for (size_t i = domain.mFirst; i < domain.mLast; ++i) {
+      Core& c = cores[i];
+      c       = {mCores[i], 0, int(mCores[i + 1] - mCores[i]), 0};
+      for (size_t j = mCores[i]; j < mCores[i + 1]; ++j) {
+        if (free.is_set(mCPUs[j]))
+          cpus[c.mFirst + c.mFree++] = mCPUs[j];
+      }
+    }
+    domain.mCollected = true;
+  };
+
+  // Select the core in domain to take CPUs from when n more CPUs are needed.
+  // Whole cores that are used completely come first, then partially used
+  // cores that are used completely, so that jobs don't share cores unless
+  // necessary. If only part of a core is needed, use the core with the fewest
+  // available CPUs that is sufficient, again sparing whole cores.
+  auto select = [&](Domain& domain, int n) -> Core* {
+    Core* best      = nullptr;
+    int   best_rank = 0;
+    if (!domain.mCollected)
+      collect(domain);
+    for (size_t i = domain.mFirst; i < domain.mLast; ++i) {
+      Core& c     = cores[i];
+      int   avail = c.mFree - c.mTaken;
+      if (!avail)
+        continue;
+      bool whole = !c.mTaken && (c.mFree == c.mSize);
+      int  rank  = (avail <= n) ? (whole ? 0 : 1) : (whole ? 3 : 2);
+      if (!best || (rank < best_rank) ||
+          ((rank == best_rank) && (rank >= 2) &&
+           (avail < best->mFree - best->mTaken))) {
+        best      = &c;
+        best_rank = rank;
+        if (0 == rank)
+          break;
+      }
+    }
+    return best;
+  };
+
+  // Take up to n CPUs from core, returning the number of CPUs taken.
+  auto take = [&](Domain& domain, Core& c, int n) {
+    int taken = std::min(n, c.mFree - c.mTaken);
+    for (int i = 0; i < taken; ++i)
+      result.set(cpus[c.mFirst + c.mTaken + i]);
+    c.mTaken += taken;
+    domain.mFree -= taken;
+    return taken;
+  };
+
+  if (AllocationPolicy::Compact == mPolicy) {
+    // Use the domain with the fewest free CPUs that can hold all requested
+    // CPUs, so that domains with more free CPUs remain available for wider
+    // jobs.
+    Domain* best = nullptr;
+    for (Domain& domain : domains) {
+      if ((domain.mFree >= count) && (!best || (domain.mFree < best->mFree)))
+        best = &domain;
+    }
+
+    // If no domain is large enough, fill up the domains with the most free
+    // CPUs, preferring the node with the most free CPUs.
+    std::vector<Domain*>& order = mOrder;
+    order.clear();
+    if (best) {
+      order.push_back(best);
+    }
+    else {
+      for (Domain& domain : domains)
+        order.push_back(&domain);
+      std::sort(order.begin(), order.end(),
+                [&](Domain const* a, Domain const* b) {
+                  if (node_free[a->mNode] != node_free[b->mNode])
+                    return node_free[a->mNode] > node_free[b->mNode];
+                  if (a->mFree != b->mFree)
+                    return a->mFree > b->mFree;
+                  return a < b;
+                });
+    }
+
+    for (Domain* domain : order) {
+      while ((count > 0) && domain->mFree) {
+        Core* c = select(*domain, count);
+        if (!c)
+          break;
+        count -= take(*domain, *c, count);
+      }
+    }
+  }
+  else {
+    // Take one core from each domain in turn, starting with the domains that
+    // have the most free CPUs.
+    std::vector<Domain*>& order = mOrder;
+    order.clear();
+    for (Domain& domain : domains)
+      order.push_back(&domain);
+    std::sort(order.begin(), order.end(),
+              [](Domain const* a, Domain const* b) {
+                if (a->mFree != b->mFree)
+                  return a->mFree > b->mFree;
+                return a < b;
+              });
+
+    bool progress = true;
+    while ((count > 0) && progress) {
+      progress = false;
+      for (Domain* domain : order) {
+        Core* c = (count && domain->mFree) ? select(*domain, count) : nullptr;
+        if (c) {
+          count -= take(*domain, *c, count);
+          progress = true;
+        }
+      }
+    }
+  }
+
+  if (count)
+    result.zero();
+  return result;
+}
+
+CPUSet CPUAllocator::allocate(CPUSet const& free, int count,
+                              CPUSet const& preferred) const
+{
+  CPUSet result = allocate(free & preferred, count);
+  return result.empty() ? allocate(free, count) : result;
+}
+
+long CPUAllocator::concentration(CPUSet const& free) const
+{
+  // The topology's order lists CPUs sharing a cache next to each other.
+  long result = 0;
+  int  llc = -1, n = 0;
+  for (int cpu : mTopology.order()) {
+    if (mTopology[cpu].mLLC != llc) {
+      result += n * n;
+      llc = mTopology[cpu].mLLC;
+      n   = 0;
+    }
+    n += free.is_set(cpu);
+  }
+  return result + n * n;
+}
+
+// Return the number of last level caches the CPUs in set belong to.
+static int llcs(CPUTopology const& topology, CPUSet const& set)
+{
+  CPUSet ids;
+  for (int cpu = set.first(), last = set.last(); cpu <= last; ++cpu) {
+    if (set.is_set(cpu) && topology.online(cpu))
+      ids.set(topology[cpu].mLLC);
+  }
+  return ids.count();
+}
+
+Move CPUAllocator::defragment(CPUSet const&              free,
+                              std::vector<CPUSet> const& partitions) const
+{
+  Move move;
+  long best = concentration(free);
+  for (CPUSet const& from : partitions) {
+    // The partition may keep some of its CPUs.
+    CPUSet to = allocate(free | from, from.count());
+    if (to.empty() || (to == from) ||
+        (llcs(mTopology, to) > llcs(mTopology, from)))
+      continue;
+
+    CPUSet after = free | from;
+    long   value = concentration((after ^ to) & after);
+    if (value > best) {
+      best       = value;
+      move.mFrom = from;
+      move.mTo   = to;
+    }
+  }
+  return move;
+}
@@ -0,0 +1,139 @@
+// CPUAllocator.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef CPUAllocator_hpp
+#define CPUAllocator_hpp
+
+#include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+
+#include <string>
+#include <vector>
+
+//! Policies for selecting CPUs automatically.
+enum class AllocationPolicy
+{
+  //! Use the lowest numbered free CPUs.
+  Linear,
+  //! Use as few last level caches as possible, preferring the cache with the
+  //! fewest free CPUs that can hold all requested CPUs, and whole cores.
+  Compact,
+  //! Distribute the CPUs over as many last level caches as possible, one core
+  //! at a time.
+  Spread
+};
+
+//! Move of a partition to other CPUs.
+struct Move
+{
+  CPUSet mFrom;
+  CPUSet mTo;
+
+  bool empty() const
+  {
+    return mFrom.empty();
+  }
+};
+
+//! Select CPUs for a partition from the free CPUs according to the topology
+//! and an allocation policy.
+class CPUAllocator
+{
+protected:
+  //! Last level cache domain, as a range of mCores.
+  struct LLC
+  {
+    int    mNode;
+    size_t mFirst;
+    size_t mLast;
+    CPUSet mSet;
+  };
+
+  //! Free CPUs of a physical core during allocate, as a range in mFree.
+  struct Core
+  {
+    size_t mFirst;
+    int    mFree;
+    int    mSize;
+    int    mTaken;
+  };
+
+  //! Free CPUs of a last level cache during allocate.
+  struct Domain
+  {
+    int    mNode;
+    size_t mFirst;
+    size_t mLast;
+    int    mFree;
+    bool   mCollected;
+  };
+
+  CPUTopology const& mTopology;
+  AllocationPolicy   mPolicy;
+  //! The online CPUs in the topology's order.
+  std::vector<int> mCPUs;
+  //! Start of each physical core in mCPUs, followed by mCPUs.size().
+  std::vector<size_t> mCores;
+  //! The last level caches in the topology's order.
+  std::vector<LLC> mLLCs;
+  //! Number of NUMA nodes, i.e. the highest node number plus one.
+  int mNodes;
+
+  //! Scratch space for allocate, kept between calls so that allocating CPUs
+  //! doesn't need the heap. This makes allocate not thread safe.
+  mutable std::vector<int>     mFree;
+  mutable std::vector<Core>    mFreeCores;
+  mutable std::vector<Domain>  mFreeLLCs;
+  mutable std::vector<int>     mNodeFree;
+  mutable std::vector<Domain*> mOrder;
+
+public:
+  CPUAllocator(CPUTopology const& topology,
+               AllocationPolicy   policy = AllocationPolicy::Compact);
+
+  //! Select count CPUs from free. Returns an empty set if free does not
+  //! contain enough (online) CPUs.
+  CPUSet allocate(CPUSet const& free, int count) const;
+  //! Select count CPUs from free, using only CPUs in preferred if there are
+  //! enough of them.
+  CPUSet allocate(CPUSet const& free, int count,
+                  CPUSet const& preferred) const;
+
+  //! Return how concentrated the CPUs in free are, as the sum of the squares
+  //! of the number of CPUs in each last level cache. Higher is better for
+  //! allocating wide partitions.
+  long concentration(CPUSet const& free) const;
+
+  //! Find the move of one of partitions to CPUs selected from free and its
+  //! own CPUs that concentrates the free CPUs the most, without spreading the
+  //! partition over more last level caches. Returns an empty move if no move
+  //! improves the concentration.
+  Move defragment(CPUSet const&              free,
+                  std::vector<CPUSet> const& partitions) const;
+
+  //! Return the policy called name ('linear', 'compact', or 'spread').
+  //! \throw std::invalid_argument if there is no such policy.
+  static AllocationPolicy policy(std::string const& name);
+};
+
+#endif // CPUAllocator_hpp
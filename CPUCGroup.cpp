@@ -23,6 +23,7 @@
 //
 
 #include "CPUCGroup.hpp"
+#include "print.hpp"
 #include "sysfs.hpp"
 
 #include <fcntl.h>
@@ -33,17 +34,27 @@
 #include <sys/inotify.h> // for inotify(7)
 #include <sys/stat.h>
 #include <sys/syscall.h> // Definition of SYS_* constants
+#include <sys/wait.h>
+#include <sys/xattr.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
-#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <system_error>
 
 namespace fs = std::filesystem;
 
+//! Path to the sysctl tunables
+#define PROC_SYS "/proc/sys"
+
 //
 // Helper functions to interact with the filesystem
 //
@@ -78,13 +89,60 @@ public:
 };
 
 
-// Remove '\n' and any following characters from the string.
-std::string& chomp(std::string& str)
+// Return the value of key in the flat keyed file path (e.g. cgroup.events),
+// or -1 if the file has no such key.
+static long read_key(fs::path const& path, char const* key)
+{
+  std::string content = read_file(path);
+  size_t      length  = ::strlen(key);
+  for (size_t pos = 0; std::string::npos != pos;) {
+    if (!content.compare(pos, length, key) && (' ' == content[pos + length]))
+      return std::strtol(content.c_str() + pos + length + 1, nullptr, 10);
+    pos = content.find('\n', pos);
+    if (std::string::npos != pos)
+      ++pos;
+  }
+  return -1;
+}
+
+// Return the value of the extended attribute name of path, or an empty string
+// if path doesn't have it (or the filesystem doesn't support xattrs).
+static std::string get_xattr(fs::path const& path, char const* name)
+{
+  // Records like the parked CPUs grow with the number of CPUs, so size the
+  // buffer to the value, and try again if it grew in the meantime.
+  for (;;) {
+    ssize_t size = ::getxattr(path.c_str(), name, nullptr, 0);
+    if (0 == size)
+      return std::string();
+    if (size > 0) {
+      std::string value(size, '\0');
+      ssize_t     len = ::getxattr(path.c_str(), name, &value[0], size);
+      if (len >= 0) {
+        value.resize(len);
+        return value;
+      }
+    }
+    if ((ENODATA == errno) || (ENOTSUP == errno))
+      return std::string();
+    if (ERANGE != errno)
+      throw std::system_error(errno, std::system_category(),
+                              "getxattr(" + path.string() + ", " + name +
+                                  ")");
+  }
+}
+
+// Set the extended attribute name of path to value, or remove it if value is
+// empty.
+static void set_xattr(fs::path const& path, char const* name,
+                      std::string const& value)
 {
-  auto end = str.find_first_of("\n");
-  if (end != std::string::npos)
-    str.resize(end);
-  return str;
+  int err = value.empty() ? ::removexattr(path.c_str(), name)
+                          : ::setxattr(path.c_str(), name, value.data(),
+                                       value.size(), 0);
+  if (err && !(value.empty() && (ENODATA == errno)))
+    throw std::system_error(errno, std::system_category(),
+                            "setxattr(" + path.string() + ", " + name + ")");
 }
 
 //! Write '+cpuset' to the cgroup.subtree_control file at path if it is not
@@ -165,44 +223,82 @@ public:
   }
 };
 
+// Call fn for every partition in all slices. Each slice is called
+// runexcl[.<pool>].slice and each partition runexcl.<cpus>. Partitions that
+// disappear while fn looks at them are skipped.
+static void
+for_each_partition(std::function<void(fs::path const& partition)> const& fn)
+{
+  for (auto const& slice : fs::directory_iterator(CGROUP_ROOT)) {
+    std::string name = slice.path().filename();
+    if (!slice.is_directory() || name.compare(0, 7, "runexcl") ||
+        (name.size() < 13) || name.compare(name.size() - 6, 6, ".slice"))
+      continue;
+
+    for (auto const& partition : fs::directory_iterator(slice.path())) {
+      if (!partition.is_directory() ||
+          partition.path().filename().string().compare(0, 8, "runexcl."))
+        continue;
+
+      try {
+        fn(partition.path());
+      }
+      catch (std::system_error const&) {
+      }
+    }
+  }
+}
+
 //
 // Class functions to handle the runexcl.slice cgroup
 //
 
-// Make sure the runexcl.slice cgroup is setup and return a CPUSet object
+// Make sure the pool's slice cgroup is setup and return a CPUSet object
 // containing all the CPUs it can use.
-CPUSet CPUCGroup::setupSlice()
+CPUSet CPUCGroup::setupSlice(Pool const& pool)
 {
   // Make sure the 'cpuset' controller is active for children of the root
   // cgroup.
   enableCpusetController(CGROUP_ROOT);
 
-  // If the runexcl.slice cgroup doesn't exist, create it.
-  if (::mkdir(RUNEXCL_SLICE,
-              S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+  // If the slice cgroup doesn't exist, create it.
+  std::string path = pool.slice();
+  if (::mkdir(path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
     if (EEXIST != errno)
       throw std::system_error(errno, std::system_category(),
-                              "mkdir(\"" RUNEXCL_SLICE "\")");
+                              "mkdir(\"" + path + "\")");
   }
 
   // Enable the 'cpuset' controller for the slice's children.
-  enableCpusetController(RUNEXCL_SLICE);
-
-  // Determine the effective cpuset for the slice.
-  fs::path slice(RUNEXCL_SLICE);
-  CPUSet   effective_set = CPUSet(sysfs_read(slice / "cpuset.cpus.effective"));
+  enableCpusetController(path.c_str());
 
-  // If the cpuset.cpus hasn't been set for the slice, set it to the effective
-  // cpus. This is necessary because cgroup v2 will not let us create a remote
-  // cpuset partition unless the parent's cpuset.cpus and cpuset.cpus.exclusive
-  // are set.
-  std::fstream file(slice / "cpuset.cpus");
-  CPUSet       set;
-  file >> set;
-  if (set.empty())
-    file << effective_set;
+  // If the pool has its own CPUs, make sure the slice is restricted to them.
+  // A pool without its own CPUs gets the CPUs other pools don't reserve, as
+  // sibling slices cannot share exclusive CPUs. Otherwise, if the cpuset.cpus
+  // hasn't been set for the slice, set it to the effective cpus. This is
+  // necessary because cgroup v2 will not let us create a remote cpuset
+  // partition unless the parent's cpuset.cpus and cpuset.cpus.exclusive are
+  // set.
+  fs::path slice(path);
+  CPUSet   set(sysfs_read(slice / "cpuset.cpus"));
+  CPUSet   cpus(pool.mCPUs);
+  if (cpus.empty() && !pool.mClaimed.empty()) {
+    CPUSet all(sysfs_read(CGROUP_ROOT "/cpuset.cpus.effective"));
+    cpus = (all ^ pool.mClaimed) & all;
+    if (cpus.empty())
+      throw std::runtime_error("Other pools reserve all CPUs");
+  }
+  if (!cpus.empty()) {
+    if (set != cpus)
+      sysfs_write(slice / "cpuset.cpus", cpus);
+  }
+  else if (set.empty()) {
+    sysfs_write(slice / "cpuset.cpus",
+                CPUSet(sysfs_read(slice / "cpuset.cpus.effective")));
+  }
 
-  return effective_set;
+  // Determine the effective cpuset for the slice.
+  return CPUSet(sysfs_read(slice / "cpuset.cpus.effective"));
 }
 
 //
@@ -216,41 +312,431 @@ void CPUCGroup::remove()
                             "rmdir(\"" + mPath + "\"):");
 }
 
+void CPUCGroup::create(fs::path const& cpuset_cpus_exclusive,
+                       CPUSet exclusive, Quota const& quota, bool isolate)
+{
+  // Check the quota. Usage is counted over all slices, so the check and
+  // recording the new partition are serialized over all slices by locking
+  // the root cgroup, like reduce_noise() does. The lock must be released
+  // before isolating the partition, since reduce_noise() takes it again.
+  uid_t                     uid = ::getuid();
+  std::unique_ptr<FileLock> quota_lock;
+  if (!quota.unlimited()) {
+    quota_lock.reset(new FileLock(CGROUP_ROOT));
+    quota.check(usage(uid), mCPUSet.count(), isolate);
+  }
+
+  // Update the exclusive cpuset.
+  exclusive |= mCPUSet;
+  sysfs_write(cpuset_cpus_exclusive, exclusive);
+
+  // Use the cpuset to name the runexcl subslice. cgroup v2 doesn't support
+  // renaming cgroups, so a partition moved by compact() keeps its name, and
+  // we may need to add a number to make the name unique.
+  std::string name = mSlice + "/runexcl." + mCPUSet.to_string();
+  mPath            = name;
+  for (int n = 1;
+       ::mkdir(mPath.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+       ++n) {
+    if (EEXIST != errno)
+      throw std::system_error(errno, std::system_category(),
+                              "mkdir(" + mPath + ")");
+    mPath = name + "." + std::to_string(n);
+  }
+
+  try {
+    // Record the owner so the partition counts against the owner's quota.
+    // If the quota is unlimited, the record is not needed, so failures
+    // (e.g. on kernels without xattr support for cgroups) are ignored.
+    try {
+      set_xattr(mPath, RUNEXCL_OWNER_XATTR, std::to_string(uid));
+    }
+    catch (std::system_error const&) {
+      if (!quota.unlimited())
+        throw;
+    }
+
+    // Record the job class so later partitions of the class avoid us.
+    if (!mClass.empty())
+      set_xattr(mPath, RUNEXCL_CLASS_XATTR, mClass + ' ' + mAntiAffinity);
+
+    sysfs_write(fs::path(mPath) / "cpuset.cpus", mCPUSet);
+    quota_lock.reset();
+    this->isolate(isolate);
+
+    // Our CPUs may have been parked for a boosted partition.
+    park(mSlice, exclusive);
+  }
+  catch (...) {
+    remove();
+    throw;
+  }
+}
+
+void CPUCGroup::park(std::string const& slice, CPUSet const& exclusive)
+{
+  // The CPUs parked so far, with their original scaling_max_freq, are
+  // recorded with the slice, so that whoever changes the set of boosted
+  // partitions or free CPUs next can restore them, even if the process that
+  // parked them is gone.
+  std::map<int, std::string> parked;
+  std::istringstream         record(get_xattr(slice, RUNEXCL_PARKED_XATTR));
+  int                        cpu;
+  std::string                khz;
+  while (record >> cpu >> khz)
+    parked[cpu] = khz;
+
+  bool boost = false;
+  for (auto const& partition : fs::directory_iterator(slice)) {
+    if (partition.is_directory() &&
+        !partition.path().filename().string().compare(0, 8, "runexcl.") &&
+        !get_xattr(partition.path(), RUNEXCL_BOOST_XATTR).empty()) {
+      boost = true;
+      break;
+    }
+  }
+
+  // While there is a boosted partition, all free CPUs of the slice should be
+  // parked, i.e. the CPUs in cpuset.cpus but not in cpuset.cpus.exclusive.
+  CPUSet target;
+  if (boost) {
+    CPUSet cpus(sysfs_read(fs::path(slice) / "cpuset.cpus"));
+    target = (cpus ^ exclusive) & cpus;
+  }
+
+  bool changed = false;
+  for (auto it = parked.begin(); it != parked.end();) {
+    if (target.is_set(it->first)) {
+      target.clr(it->first);
+      ++it;
+      continue;
+    }
+    sysfs_write(fs::path(CPU_ROOT) / ("cpu" + std::to_string(it->first)) /
+                    "cpufreq/scaling_max_freq",
+                it->second);
+    it      = parked.erase(it);
+    changed = true;
+  }
+
+  // Only park CPUs whose cpufreq policy doesn't also control CPUs that are in
+  // use.
+  for (int cpu = 0, last = target.last(); cpu <= last; ++cpu) {
+    fs::path cpufreq =
+        fs::path(CPU_ROOT) / ("cpu" + std::to_string(cpu)) / "cpufreq";
+    if (!target.is_set(cpu) || !fs::exists(cpufreq))
+      continue;
+
+    bool shared = false;
+    for (std::string const& other : sysfs_read_words(cpufreq / "related_cpus"))
+      shared |= !target.is_set(std::stoi(other));
+    if (shared)
+      continue;
+
+    parked[cpu] = sysfs_read(cpufreq / "scaling_max_freq");
+    sysfs_write(cpufreq / "scaling_max_freq",
+                sysfs_read(cpufreq / "cpuinfo_min_freq"));
+    changed = true;
+  }
+
+  if (changed) {
+    std::string value;
+    for (auto const& entry : parked)
+      value += std::to_string(entry.first) + " " + entry.second + " ";
+    set_xattr(slice, RUNEXCL_PARKED_XATTR, value);
+  }
+}
+
+void CPUCGroup::isolate(bool enable)
+{
+  set_partition_type(enable ? "isolated" : "root");
+
+  // Reference the pool's noise profile while the partition is isolated.
+  if (!mNoise.empty()) {
+    set_xattr(mPath, RUNEXCL_NOISE_XATTR,
+              enable ? mNoise.to_string() : std::string());
+    reduce_noise();
+  }
+}
+
+void CPUCGroup::boost()
+{
+  fs::path cpuset_cpus_exclusive = fs::path(mSlice) / "cpuset.cpus.exclusive";
+  FileLock lock(cpuset_cpus_exclusive);
+  set_xattr(mPath, RUNEXCL_BOOST_XATTR, "1");
+  park(mSlice, CPUSet(sysfs_read(cpuset_cpus_exclusive)));
+}
+
+void CPUCGroup::set_movable()
+{
+  set_xattr(mPath, RUNEXCL_MOVABLE_XATTR, "1");
+}
+
+void CPUCGroup::steer(std::vector<std::string> const& files)
+{
+  std::string value;
+  for (std::string const& file : files)
+    value += file + "\n";
+  set_xattr(mPath, RUNEXCL_NETQUEUES_XATTR, value);
+  steer_net_queues();
+}
+
+// Return set in the format of the steering file path, i.e. as a list of CPUs
+// for an interrupt's smp_affinity_list, and as a mask for rps_cpus and
+// xps_cpus.
+static std::string steering(fs::path const& path, CPUSet const& set)
+{
+  return ("smp_affinity_list" == path.filename()) ? set.to_string()
+                                                  : set.to_mask();
+}
+
+void CPUCGroup::steer_net_queues()
+{
+  // Network queues and interrupts are global, so like the kernel tunables,
+  // changes are serialized by locking the root cgroup, and the original
+  // values are recorded with it. The state is derived from the partitions
+  // that exist, so whoever stops steering a file last restores it, even if
+  // the process that steered it is gone.
+  FileLock lock(CGROUP_ROOT);
+
+  std::map<std::string, CPUSet> target;
+  for_each_partition([&](fs::path const& partition) {
+    std::string files = get_xattr(partition, RUNEXCL_NETQUEUES_XATTR);
+    if (files.empty())
+      return;
+    CPUSet             set(sysfs_read(partition / "cpuset.cpus"));
+    std::istringstream in(files);
+    for (std::string file; in >> file;)
+      target[file] |= set;
+  });
+
+  std::map<std::string, std::string> saved;
+  std::istringstream record(get_xattr(CGROUP_ROOT, RUNEXCL_NETSAVED_XATTR));
+  for (std::string file, value; record >> file >> value;)
+    saved[file] = value;
+
+  auto record_saved = [&]() {
+    std::string value;
+    for (auto const& entry : saved)
+      value += entry.first + " " + entry.second + "\n";
+    set_xattr(CGROUP_ROOT, RUNEXCL_NETSAVED_XATTR, value);
+  };
+
+  // Record the original values before changing anything. Files that have
+  // gone away (e.g. with their network interface) are skipped.
+  size_t count = saved.size();
+  for (auto it = target.begin(); it != target.end();) {
+    try {
+      if (!saved.count(it->first))
+        saved[it->first] = sysfs_read(it->first);
+      ++it;
+    }
+    catch (std::exception const& e) {
+      print(2, "%s\n", e.what());
+      it = target.erase(it);
+    }
+  }
+  if (saved.size() != count)
+    record_saved();
+
+  // Some interrupts cannot be moved (e.g. because they are managed by the
+  // kernel), which is not a reason to fail.
+  bool restored = false;
+  for (auto it = saved.begin(); it != saved.end();) {
+    auto want = target.find(it->first);
+    try {
+      if (want != target.end())
+        sysfs_write(it->first, steering(it->first, want->second));
+      else
+        sysfs_write(it->first, it->second);
+    }
+    catch (std::exception const& e) {
+      print(2, "%s\n", e.what());
+    }
+    if (want == target.end()) {
+      it       = saved.erase(it);
+      restored = true;
+    }
+    else {
+      ++it;
+    }
+  }
+  if (restored)
+    record_saved();
+}
+
 void CPUCGroup::set_partition_type(char const* type)
 {
-  std::fstream fpart(mPath + "/cpuset.cpus.partition");
-  fpart << type;
-  fpart.seekp(0);
-  std::string _type;
-  fpart >> _type;
-  chomp(_type);
+  fs::path fpart = fs::path(mPath) / "cpuset.cpus.partition";
+  sysfs_write(fpart, type);
+  std::string _type = sysfs_read(fpart);
   if (type != _type)
     throw std::runtime_error("Could not set partition type to '" +
                              std::string(type) + "': " + _type);
 }
 
+void CPUCGroup::reduce_noise()
+{
+  // The tunables are global, so changes are serialized over all slices by
+  // locking the root cgroup, and their original values are recorded with it.
+  // Like for parked CPUs, the state is derived from the partitions that exist,
+  // so whoever removes the last isolated partition restores the tunables,
+  // even if the process that changed them is gone.
+  FileLock lock(CGROUP_ROOT);
+
+  NoiseProfile profile;
+  CPUSet       cpus;
+  for_each_partition([&](fs::path const& partition) {
+    std::string noise = get_xattr(partition, RUNEXCL_NOISE_XATTR);
+    if (noise.empty() ||
+        ("isolated" != sysfs_read(partition / "cpuset.cpus.partition")))
+      return;
+    CPUSet set(sysfs_read(partition / "cpuset.cpus"));
+    profile |= NoiseProfile(noise);
+    cpus |= set;
+  });
+
+  std::map<std::string, std::string> saved;
+  std::istringstream record(get_xattr(CGROUP_ROOT, RUNEXCL_SYSCTL_XATTR));
+  for (std::string name, value; record >> name >> value;)
+    saved[name] = value;
+  auto original = [&](std::string const& name) {
+    auto it = saved.find(name);
+    return (it != saved.end()) ? it->second
+                               : sysfs_read(fs::path(PROC_SYS) / name);
+  };
+
+  std::map<std::string, std::string> target;
+  if (profile.mWatchdog) {
+    CPUSet watchdog(original("kernel/watchdog_cpumask"));
+    watchdog = (watchdog ^ cpus) & watchdog;
+    // The watchdog must run somewhere.
+    if (!watchdog.empty())
+      target["kernel/watchdog_cpumask"] = watchdog.to_string();
+  }
+  if (profile.mStatInterval) {
+    int interval = std::stoi(original("vm/stat_interval"));
+    target["vm/stat_interval"] =
+        std::to_string(std::max(interval, profile.mStatInterval));
+  }
+  if (NOISE_UNSET != profile.mRTRuntime)
+    target["kernel/sched_rt_runtime_us"] = std::to_string(profile.mRTRuntime);
+  if (NOISE_UNSET != profile.mTimerMigration)
+    target["kernel/timer_migration"] = std::to_string(profile.mTimerMigration);
+
+  auto record_saved = [&]() {
+    std::string value;
+    for (auto const& entry : saved)
+      value += entry.first + " " + entry.second + "\n";
+    set_xattr(CGROUP_ROOT, RUNEXCL_SYSCTL_XATTR, value);
+  };
+
+  // Record the original values before changing anything.
+  size_t count = saved.size();
+  for (auto const& entry : target)
+    saved[entry.first] = original(entry.first);
+  if (saved.size() != count)
+    record_saved();
+
+  bool restored = false;
+  for (auto it = saved.begin(); it != saved.end();) {
+    fs::path path = fs::path(PROC_SYS) / it->first;
+    auto     want = target.find(it->first);
+    if (want == target.end()) {
+      sysfs_write(path, it->second);
+      it       = saved.erase(it);
+      restored = true;
+      continue;
+    }
+    if (sysfs_read(path) != want->second)
+      sysfs_write(path, want->second);
+    ++it;
+  }
+  if (restored)
+    record_saved();
+}
+
+Reservations CPUCGroup::reservations(std::string const& slice, time_t now)
+{
+  Reservations reservations(get_xattr(slice, RUNEXCL_RESERVATIONS_XATTR));
+  reservations.prune(now);
+  return reservations;
+}
+
+void CPUCGroup::check_reservations(time_t now, time_t end) const
+{
+  if (!end)
+    end = std::numeric_limits<time_t>::max();
+
+  for (Reservation const& reservation :
+       reservations(mSlice, now).reservations()) {
+    CPUSet conflict = reservation.mCPUs & mCPUSet;
+    if ((reservation.mPID != ::getpid()) && !conflict.empty() &&
+        reservation.overlaps(now, end))
+      throw std::runtime_error("CPUs '" + conflict.to_string() +
+                               "' are reserved for " + reservation.window());
+  }
+}
+
 //
 // Public interface
 //
 
+CPUSet CPUCGroup::conflicts(CPUTopology const& topology) const
+{
+  // A partition of the same class rules out the scope of our rule as well as
+  // the scope of the rule it was created with, which may differ if it is in
+  // another pool. Partitions in other pools are checked without holding
+  // their slice's lock, so concurrent requests in different pools may still
+  // end up sharing a scope.
+  CPUSet result;
+  if (mClass.empty())
+    return result;
+  for_each_partition([&](fs::path const& partition) {
+    std::istringstream label(get_xattr(partition, RUNEXCL_CLASS_XATTR));
+    std::string        job_class, scope;
+    if (!(label >> job_class) || (job_class != mClass))
+      return;
+    label >> scope;
+
+    CPUSet cpus(sysfs_read(partition / "cpuset.cpus"));
+    for (int cpu : topology.order()) {
+      if (!cpus.is_set(cpu))
+        continue;
+      for (std::string const& s : {scope, mAntiAffinity}) {
+        if ("llc" == s)
+          result |= topology.llc(cpu);
+        else if ("node" == s)
+          result |= topology.node(topology[cpu].mNode);
+      }
+    }
+  });
+  return result;
+}
+
 CPUCGroup::~CPUCGroup()
 {
-  try {
-    // Remove the cgroup.
-    remove();
+  // Attached sessions are removed by the process holding them.
+  if (mAttached)
+    return;
 
-    // Remove the CPUs that where part of this group from
-    // runexcl.slice/cpuset.cpus.exclusive to make them available to again.
+  try {
+    // Remove the CPUs that where part of this group from the slice's
+    // cpuset.cpus.exclusive to make them available to again.
     // Unfortunately, if a remote partition is removed, its CPUs are not
     // immediately available to the other partitions, and I found no way to
     // determine when the update is complete. As a result, we can't simply
     // remove any CPU that appears in runexcl.slice/cpuset.cpus.effective from
     // runexcl.slice/cpuset.cpus.exclusive, which would be the robust way to do
-    // this. Instead, we assume mCPUSet is accurate.
+    // this. Instead, we read the partition's cpuset.cpus before removing it,
+    // since compact() may have moved it to other CPUs.
     fs::path cpuset_cpus_exclusive =
-        fs::path(RUNEXCL_SLICE) / "cpuset.cpus.exclusive";
+        fs::path(mSlice) / "cpuset.cpus.exclusive";
     FileLock lock(cpuset_cpus_exclusive);
     CPUSet   exclusive = CPUSet(sysfs_read(cpuset_cpus_exclusive));
+    mCPUSet            = CPUSet(sysfs_read(fs::path(mPath) / "cpuset.cpus"));
+
+    // Remove the cgroup.
+    remove();
 
     // As an additional complication, CPUSet does not provide a NOT operation
     // (mainly because CPU_SET does not). As a result, we need to make use of
@@ -266,20 +752,56 @@ CPUCGroup::~CPUCGroup()
     // will look in cpuset.cpus.effective instead.
     exclusive = (exclusive ^ mCPUSet) & exclusive;
     sysfs_write(cpuset_cpus_exclusive, exclusive);
+
+    // Park our CPUs if other partitions are boosted, or restore the free CPUs
+    // if we were the last boosted partition.
+    park(mSlice, exclusive);
+
+    // Restore the kernel tunables if we were the last isolated partition
+    // with a noise profile.
+    if (!mNoise.empty() ||
+        !get_xattr(CGROUP_ROOT, RUNEXCL_SYSCTL_XATTR).empty())
+      reduce_noise();
+
+    // Restore the network queues and interrupts if we were the last
+    // partition steering them, or if their holder is gone.
+    if (!get_xattr(CGROUP_ROOT, RUNEXCL_NETSAVED_XATTR).empty())
+      steer_net_queues();
+
+    // If the partition was created for a reservation, release it.
+    std::string records = get_xattr(mSlice, RUNEXCL_RESERVATIONS_XATTR);
+    if (!records.empty()) {
+      Reservations reservations(records);
+      reservations.prune(::time(nullptr));
+      reservations.remove(::getpid());
+      set_xattr(mSlice, RUNEXCL_RESERVATIONS_XATTR, reservations.to_string());
+    }
   }
   catch (const std::exception& e) {
     // Destructors should throw exceptions, so just report the error.
-    std::cerr << e.what() << '\n';
+    print(2, "%s\n", e.what());
   }
 }
 
-CPUCGroup::CPUCGroup(CPUSet const& set) : mCPUSet(set)
+// Return the scope of pool's anti-affinity rule for job_class, or an empty
+// string if there is none.
+static std::string anti_affinity(Pool const&        pool,
+                                 std::string const& job_class)
 {
-  // Open runexcl.slice/cpuset.cpus.exclusive and lock it. We use this file to
+  auto rule = pool.mAntiAffinity.find(job_class);
+  return (rule != pool.mAntiAffinity.end()) ? rule->second : std::string();
+}
+
+CPUCGroup::CPUCGroup(Pool const& pool, Quota const& quota, CPUSet const& set,
+                     bool isolate, time_t end, std::string const& job_class)
+  : mCPUSet(set), mSlice(pool.slice()), mNoise(pool.mNoise),
+    mClass(job_class), mAntiAffinity(anti_affinity(pool, job_class))
+{
+  // Open the slice's cpuset.cpus.exclusive and lock it. We use this file to
   // keep track of which CPUs are already allocated. The lock is to prevent
   // race conditions when multiple runexcl processes try to allocate exclusive
-  // CPUs.
-  fs::path slice                 = fs::path(RUNEXCL_SLICE);
+  // CPUs. Since each pool has its own slice, pools don't contend for the lock.
+  fs::path slice                 = fs::path(mSlice);
   fs::path cpuset_cpus_exclusive = slice / "cpuset.cpus.exclusive";
   FileLock lock(cpuset_cpus_exclusive);
   CPUSet   exclusive = CPUSet(sysfs_read(cpuset_cpus_exclusive));
@@ -291,27 +813,372 @@ CPUCGroup::CPUCGroup(CPUSet const& set) : mCPUSet(set)
     throw std::runtime_error("Requested cpuset '" + set.to_string() +
                              "' not a subset of '" + available.to_string() +
                              "'");
+  check_reservations(::time(nullptr), end);
 
-  // Update the exclusive cpuset.
-  exclusive |= set;
-  sysfs_write(cpuset_cpus_exclusive, exclusive);
-
-  // Use the cpuset to name the runexcl subslice..
-  mPath = slice.string() + "/runexcl." + set.to_string();
-  if (::mkdir(mPath.c_str(),
-              S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
-    throw std::system_error(errno, std::system_category(),
-                            "mkdir(" + mPath + ")");
+  if (!mClass.empty()) {
+    CPUSet conflict = conflicts(CPUTopology()) & set;
+    if (!conflict.empty())
+      throw std::runtime_error("CPUs '" + conflict.to_string() +
+                               "' are too close to a partition of class " +
+                               mClass);
   }
 
+  create(cpuset_cpus_exclusive, exclusive, quota, isolate);
+}
+
+// Return the CPUs of free a partition should use if it can. Isolated
+// partitions prefer the CPUs isolated at boot, which are quieter than
+// anything isolate() achieves at runtime, and other partitions leave them to
+// isolated ones.
+static CPUSet preferred(CPUTopology const& topology, CPUSet const& free,
+                        bool isolate)
+{
+  CPUSet quiet = topology.boot_isolated() & free;
+  return isolate ? quiet : free ^ quiet;
+}
+
+CPUCGroup::CPUCGroup(Pool const& pool, Quota const& quota, int count,
+                     CPUTopology const& topology, bool isolate,
+                     time_t end, std::string const& job_class)
+  : mCPUSet(), mSlice(pool.slice()), mNoise(pool.mNoise), mClass(job_class),
+    mAntiAffinity(anti_affinity(pool, job_class))
+{
+  // See above.
+  fs::path slice                 = fs::path(mSlice);
+  fs::path cpuset_cpus_exclusive = slice / "cpuset.cpus.exclusive";
+  FileLock lock(cpuset_cpus_exclusive);
+  CPUSet   exclusive = CPUSet(sysfs_read(cpuset_cpus_exclusive));
+
+  // The CPUs of existing partitions are not part of the slice's effective
+  // CPUs, so these are exactly the free CPUs. We cannot use
+  // cpuset.cpus.exclusive here, see the destructor for why.
+  CPUSet available(sysfs_read(slice / "cpuset.cpus.effective"));
+
+  // Leave out the CPUs other processes reserved before we are expected to
+  // end. See the destructor for how the expression removes them.
+  time_t now      = ::time(nullptr);
+  CPUSet reserved = reservations(mSlice, now).reserved(
+      now, end ? end : std::numeric_limits<time_t>::max(), ::getpid());
+  available = (available ^ reserved) & available;
+
+  // Leave out the CPUs sharing a last level cache or NUMA node with
+  // partitions of the same job class.
+  available = (available ^ conflicts(topology)) & available;
+
+  mCPUSet = CPUAllocator(topology, pool.mPolicy)
+                .allocate(available, count,
+                          preferred(topology, available, isolate));
+  if (mCPUSet.empty())
+    throw std::runtime_error("Cannot allocate " + std::to_string(count) +
+                             " CPUs from '" + available.to_string() + "'");
+
+  create(cpuset_cpus_exclusive, exclusive, quota, isolate);
+}
+
+CPUCGroup::CPUCGroup(std::string const& session) : mAttached(true)
+{
+  pid_t holder;
+  mPath = find_session(session, ::getuid(), holder);
+  if (mPath.empty())
+    throw std::runtime_error("No session '" + session + "'");
+  mSlice  = fs::path(mPath).parent_path();
+  mCPUSet = CPUSet(sysfs_read(fs::path(mPath) / "cpuset.cpus"));
+}
+
+// Return the start time of process pid in clock ticks since boot, or 0 if
+// there is no such process.
+static unsigned long long start_time(pid_t pid)
+{
+  // The command name in parentheses may contain anything, so the fields are
+  // counted from the last ')'. The start time is the 22nd field, and the 20th
+  // after the command name.
+  std::string stat;
   try {
-    sysfs_write(fs::path(mPath) / "cpuset.cpus", set);
-    set_partition_type("root");
+    stat = read_file("/proc/" + std::to_string(pid) + "/stat");
   }
-  catch (...) {
-    remove();
-    throw;
+  catch (std::system_error const&) {
+    return 0;
+  }
+  auto pos = stat.rfind(')');
+  if (std::string::npos == pos)
+    return 0;
+  std::istringstream fields(stat.substr(pos + 1));
+  std::string        field;
+  for (int i = 0; (i < 20) && (fields >> field); ++i)
+    ;
+  return std::strtoull(field.c_str(), nullptr, 10);
+}
+
+void CPUCGroup::set_session(std::string const& name, pid_t holder)
+{
+  set_xattr(mPath, RUNEXCL_SESSION_XATTR,
+            name + ' ' + std::to_string(holder) + ' ' +
+                std::to_string(start_time(holder)));
+}
+
+bool CPUCGroup::populated() const
+{
+  long populated = read_key(mPath + "/cgroup.events", "populated");
+  if (-1 != populated)
+    return populated;
+  throw std::runtime_error("Unexpected input from '" + mPath +
+                           "/cgroup.events'");
+}
+
+bool CPUCGroup::alone() const
+{
+  bool alone = true;
+  for_each_partition([&](fs::path const& partition) {
+    if (!fs::equivalent(partition, mPath))
+      alone = false;
+  });
+  return alone;
+}
+
+std::string CPUCGroup::find_session(std::string const& name, uid_t uid,
+                                    pid_t& holder)
+{
+  std::string owner = std::to_string(uid);
+  std::string result;
+  for_each_partition([&](fs::path const& partition) {
+    std::istringstream session(get_xattr(partition, RUNEXCL_SESSION_XATTR));
+    std::string        session_name;
+    pid_t              pid;
+    unsigned long long started;
+    if (!(session >> session_name >> pid >> started) ||
+        (session_name != name) ||
+        (owner != get_xattr(partition, RUNEXCL_OWNER_XATTR)))
+      return;
+    if (!started || (start_time(pid) != started))
+      return; // The session is stale.
+    holder = pid;
+    result = partition;
+  });
+  return result;
+}
+
+Usage CPUCGroup::usage(uid_t uid)
+{
+  Usage       usage;
+  std::string owner = std::to_string(uid);
+
+  for_each_partition([&](fs::path const& partition) {
+    if (owner != get_xattr(partition, RUNEXCL_OWNER_XATTR))
+      return;
+
+    // Read the partition type first, so a partition that disappears in
+    // between doesn't count at all.
+    bool isolated = "isolated" == sysfs_read(partition /
+                                             "cpuset.cpus.partition");
+    int  cpus     = CPUSet(sysfs_read(partition / "cpuset.cpus")).count();
+    usage.mCPUs += cpus;
+    if (isolated)
+      usage.mIsolated += cpus;
+  });
+
+  return usage;
+}
+
+Reservation CPUCGroup::reserve(Pool const& pool, Quota const& quota,
+                               CPUSet const& set, int count,
+                               CPUTopology const& topology, bool isolate,
+                               time_t start, time_t end)
+{
+  // Reservations are recorded with the slice and protected by the same lock
+  // as the partitions.
+  std::string path = pool.slice();
+  fs::path    slice(path);
+  FileLock    lock(slice / "cpuset.cpus.exclusive");
+
+  Reservations reservations = CPUCGroup::reservations(path, ::time(nullptr));
+  CPUSet       reserved     = reservations.reserved(start, end, ::getpid());
+
+  // The partitions existing now may be gone by the time the window starts,
+  // so we reserve from all CPUs of the slice.
+  CPUSet all(sysfs_read(slice / "cpuset.cpus"));
+  CPUSet cpus(set);
+  if (!cpus.empty()) {
+    if ((cpus & all) != cpus)
+      throw std::runtime_error("Requested cpuset '" + cpus.to_string() +
+                               "' not a subset of '" + all.to_string() +
+                               "'");
+    for (Reservation const& reservation : reservations.reservations()) {
+      CPUSet conflict = reservation.mCPUs & cpus;
+      if ((reservation.mPID != ::getpid()) && !conflict.empty() &&
+          reservation.overlaps(start, end))
+        throw std::runtime_error("CPUs '" + conflict.to_string() +
+                                 "' are already reserved for " +
+                                 reservation.window());
+    }
+  }
+  else {
+    // Prefer CPUs that are free now, so the reservation doesn't have to wait
+    // for a partition to end.
+    CPUAllocator allocator(topology, pool.mPolicy);
+    CPUSet       candidates = (all ^ reserved) & all;
+    CPUSet       effective =
+        candidates & CPUSet(sysfs_read(slice / "cpuset.cpus.effective"));
+    cpus = allocator.allocate(effective, count,
+                              preferred(topology, effective, isolate));
+    if (cpus.empty())
+      cpus = allocator.allocate(candidates, count,
+                                preferred(topology, candidates, isolate));
+    if (cpus.empty())
+      throw std::runtime_error("Cannot reserve " + std::to_string(count) +
+                               " CPUs from '" + candidates.to_string() +
+                               "'");
+  }
+
+  // The user's other partitions may be gone by then as well, so only check
+  // that the partition fits the quota by itself.
+  if (!quota.unlimited())
+    quota.check(Usage(), cpus.count(), isolate);
+
+  Reservation reservation;
+  reservation.mPID   = ::getpid();
+  reservation.mUID   = ::getuid();
+  reservation.mStart = start;
+  reservation.mEnd   = end;
+  reservation.mCPUs  = cpus;
+  reservations.remove(reservation.mPID);
+  reservations.add(reservation);
+  set_xattr(slice, RUNEXCL_RESERVATIONS_XATTR, reservations.to_string());
+  return reservation;
+}
+
+// Return the node mask for migrate_pages(2) for the nodes in nodes.
+static std::vector<unsigned long> node_mask(CPUSet const& nodes)
+{
+  size_t                     bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(nodes.last() / bits + 1);
+  for (int node = nodes.first(), last = nodes.last(); node <= last; ++node) {
+    if (nodes.is_set(node))
+      mask[node / bits] |= 1ul << (node % bits);
+  }
+  return mask;
+}
+
+Move CPUCGroup::compact(Pool const& pool, CPUTopology const& topology,
+                        bool migrate_memory)
+{
+  std::string path = pool.slice();
+  fs::path    slice(path);
+  fs::path    cpuset_cpus_exclusive = slice / "cpuset.cpus.exclusive";
+  FileLock    lock(cpuset_cpus_exclusive);
+  CPUSet      exclusive(sysfs_read(cpuset_cpus_exclusive));
+  CPUSet      free(sysfs_read(slice / "cpuset.cpus.effective"));
+
+  // Reserved CPUs are neither moved to, nor away from.
+  time_t now      = ::time(nullptr);
+  CPUSet reserved = reservations(path, now).reserved(
+      now, std::numeric_limits<time_t>::max());
+  free = (free ^ reserved) & free;
+
+  // Only consider valid partitions with running processes. Empty ones are
+  // about to be removed by their runexcl. Partitions are created unmovable,
+  // and only marked movable by their runexcl once it knows it made no
+  // settings for their CPUs, which it would otherwise restore on CPUs that
+  // may belong to another partition by then.
+  std::vector<CPUSet>   cpus;
+  std::vector<fs::path> partitions;
+  for (auto const& partition : fs::directory_iterator(slice)) {
+    fs::path dir = partition.path();
+    if (!partition.is_directory() ||
+        dir.filename().string().compare(0, 8, "runexcl."))
+      continue;
+    try {
+      std::string type = sysfs_read(dir / "cpuset.cpus.partition");
+      CPUSet      set(sysfs_read(dir / "cpuset.cpus"));
+      if ((("root" == type) || ("isolated" == type)) &&
+          (set & reserved).empty() &&
+          !get_xattr(dir, RUNEXCL_MOVABLE_XATTR).empty() &&
+          !sysfs_read(dir / "cgroup.procs").empty()) {
+        cpus.push_back(set);
+        partitions.push_back(dir);
+      }
+    }
+    catch (std::system_error const&) {
+    }
+  }
+
+  Move move = CPUAllocator(topology, pool.mPolicy).defragment(free, cpus);
+  if (move.empty())
+    return move;
+  fs::path partition =
+      partitions[std::find(cpus.begin(), cpus.end(), move.mFrom) -
+                 cpus.begin()];
+
+  // Grow the partition to both sets, so its threads can be moved.
+  sysfs_write(cpuset_cpus_exclusive, exclusive | move.mTo);
+  sysfs_write(partition / "cpuset.cpus", move.mFrom | move.mTo);
+
+  // Move each thread from its CPUs to the corresponding new ones, pairing the
+  // CPUs in topology order. This keeps threads pinned to single CPUs or
+  // cores (e.g. by OpenMP) pinned.
+  std::vector<int> map(move.mFrom.max_cpus(), -1);
+  std::vector<int> to;
+  for (int cpu : topology.order()) {
+    if (move.mTo.is_set(cpu))
+      to.push_back(cpu);
+  }
+  size_t next = 0;
+  for (int cpu : topology.order()) {
+    if (move.mFrom.is_set(cpu) && (next < to.size()))
+      map[cpu] = to[next++];
   }
+
+  // Threads may exit while we do this, which is fine.
+  for (std::string const& thread :
+       sysfs_read_words(partition / "cgroup.threads")) {
+    pid_t tid = std::stoi(thread);
+    try {
+      CPUSet affinity(tid), target;
+      for (int cpu = affinity.first(), last = affinity.last(); cpu <= last;
+           ++cpu) {
+        if (affinity.is_set(cpu) && (-1 != map[cpu]))
+          target.set(map[cpu]);
+      }
+      if (target.empty())
+        target = move.mTo;
+      target.setaffinity(tid);
+    }
+    catch (std::bad_alloc const&) {
+      // CPUSet(pid_t) reports errors this way.
+    }
+    catch (std::system_error const& e) {
+      if (ESRCH != e.code().value())
+        throw;
+    }
+  }
+
+  CPUSet from_nodes = topology.nodes(move.mFrom);
+  CPUSet to_nodes   = topology.nodes(move.mTo);
+  if (migrate_memory && (from_nodes != to_nodes)) {
+    std::vector<unsigned long> old_nodes = node_mask(from_nodes);
+    std::vector<unsigned long> new_nodes = node_mask(to_nodes);
+    unsigned long              max_node =
+        8 * sizeof(unsigned long) * std::max(old_nodes.size(),
+                                             new_nodes.size());
+    old_nodes.resize(max_node / (8 * sizeof(unsigned long)));
+    new_nodes.resize(old_nodes.size());
+
+    for (std::string const& proc :
+         sysfs_read_words(partition / "cgroup.procs")) {
+      pid_t pid = std::stoi(proc);
+      if ((-1 == ::syscall(SYS_migrate_pages, pid, max_node,
+                           old_nodes.data(), new_nodes.data())) &&
+          (ESRCH != errno))
+        throw std::system_error(errno, std::system_category(),
+                                "migrate_pages");
+    }
+  }
+
+  // Shrink the partition to its new CPUs and release the old ones.
+  sysfs_write(partition / "cpuset.cpus", move.mTo);
+  exclusive = ((exclusive ^ move.mFrom) & exclusive) | move.mTo;
+  sysfs_write(cpuset_cpus_exclusive, exclusive);
+  park(path, exclusive);
+  return move;
 }
 
 void CPUCGroup::add(pid_t pid)
@@ -341,25 +1208,46 @@ pid_t CPUCGroup::clone(int flags)
   return child;
 }
 
+int CPUCGroup::run(std::function<int()> const& fn)
+{
+  // Use fork and move the child into the cgroup instead of using clone(),
+  // since the C library doesn't know about processes created with clone3 and
+  // fn may need things like threads.
+  pid_t child = ::fork();
+  if (-1 == child)
+    throw std::system_error(errno, std::system_category(), "fork() failed:");
+
+  if (!child) {
+    int status = 1;
+    try {
+      add(::getpid());
+      status = fn();
+    }
+    catch (std::exception& e) {
+      print(2, "%s\n", e.what());
+    }
+    // Call _exit because we don't want to call the destructors in the child.
+    _exit(status);
+  }
+
+  int status;
+  while (-1 == ::waitpid(child, &status, 0)) {
+    if (EINTR != errno)
+      throw std::system_error(errno, std::system_category(),
+                              "waitpid() failed:");
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
 void CPUCGroup::wait_empty()
 {
-  std::ifstream fevents(mPath + "/cgroup.events");
-  INotify       inotify;
-  int           wd = inotify.add(mPath + "/cgroup.events", IN_MODIFY);
+  INotify inotify;
+  int     wd = inotify.add(mPath + "/cgroup.events", IN_MODIFY);
 
   while (true) {
-    fevents.seekg(0);
-
-    // operator>> will stop after the first space, so if we want to read an
-    // entire line of input until the '\n', we have to use std::getline instead.
-    std::string events;
-    std::getline(fevents, events);
-
-    auto pos = events.find("populated ");
-    if (pos != std::string::npos) {
-      events.erase(pos, ::strlen("populated "));
-      chomp(events);
-      if (!std::stoul(events))
+    long populated = read_key(mPath + "/cgroup.events", "populated");
+    if (-1 != populated) {
+      if (!populated)
         break;
 
       // In theory we should check that the watch descriptor in the event
@@ -370,7 +1258,7 @@ void CPUCGroup::wait_empty()
       assert(event.wd == wd);
     }
     else {
-      std::cerr << "unexpected input from " << mPath << std::endl; //XXX
+      print(2, "unexpected input from %s\n", mPath.c_str()); //XXX
       return;
       throw std::runtime_error("Unexpected input from '" + mPath +
                                "/cgroup.events'");
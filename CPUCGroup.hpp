@@ -25,9 +25,17 @@
 #define CPUCGroup_hpp
 
 #include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+#include "Config.hpp"
+#include "Quota.hpp"
+#include "Reservation.hpp"
 
+#include <filesystem>
+#include <ctime>
+#include <functional>
 #include <string>
 #include <unistd.h>
+#include <vector>
 
 //! Path to cgroup root
 #define CGROUP_ROOT "/sys/fs/cgroup"
@@ -35,28 +43,152 @@
 //! Path to runexcl.slice
 #define RUNEXCL_SLICE CGROUP_ROOT "/runexcl.slice"
 
+//! Extended attribute recording the uid of the user owning a partition.
+#define RUNEXCL_OWNER_XATTR "trusted.runexcl.owner"
+
+//! Extended attribute marking a boosted partition.
+#define RUNEXCL_BOOST_XATTR "trusted.runexcl.boost"
+
+//! Extended attribute of a slice recording the CPUs parked for boosted
+//! partitions and their original maximum frequencies.
+#define RUNEXCL_PARKED_XATTR "trusted.runexcl.parked"
+
+//! Extended attribute of a slice recording the reservations of its CPUs (see
+//! Reservations).
+#define RUNEXCL_RESERVATIONS_XATTR "trusted.runexcl.reservations"
+
+//! Extended attribute marking a partition that compact() may move, i.e.
+//! whose owner made no settings for its CPUs.
+#define RUNEXCL_MOVABLE_XATTR "trusted.runexcl.movable"
+
+//! Extended attribute recording the noise profile of an isolated partition.
+#define RUNEXCL_NOISE_XATTR "trusted.runexcl.noise"
+
+//! Extended attribute recording the name of the session a partition belongs
+//! to, and the pid and start time of the process holding it.
+#define RUNEXCL_SESSION_XATTR "trusted.runexcl.session"
+
+//! Extended attribute recording the job class of a partition and the scope
+//! of the anti-affinity rule it was created with (see Pool::mAntiAffinity).
+#define RUNEXCL_CLASS_XATTR "trusted.runexcl.class"
+
+//! Extended attribute of the root cgroup recording the original values of
+//! the kernel tunables changed for noise profiles.
+#define RUNEXCL_SYSCTL_XATTR "trusted.runexcl.sysctl"
+
+//! Extended attribute recording the network queue and interrupt affinity
+//! files steered onto a partition (see NetQueues).
+#define RUNEXCL_NETQUEUES_XATTR "trusted.runexcl.netqueues"
+
+//! Extended attribute of the root cgroup recording the original values of
+//! the files steered onto partitions.
+#define RUNEXCL_NETSAVED_XATTR "trusted.runexcl.netsaved"
+
 class CPUCGroup
 {
 protected:
-  CPUSet      mCPUSet;
-  std::string mPath;
+  CPUSet       mCPUSet;
+  std::string  mSlice;
+  std::string  mPath;
+  NoiseProfile mNoise;
+  std::string  mClass;
+  std::string  mAntiAffinity;
+  bool         mAttached = false;
 
+  //! Check mCPUSet against the calling user's quota, add it to exclusive,
+  //! and create the cgroup. Must be called with cpuset_cpus_exclusive locked.
+  void create(std::filesystem::path const& cpuset_cpus_exclusive,
+              CPUSet exclusive, Quota const& quota, bool isolate);
   //! Remove the cgroup from the filesystem.
   void remove();
   //! Set the cpuset partition type.
   void set_partition_type(char const* type);
+  //! Limit the free CPUs of slice to their lowest frequency while it
+  //! contains a boosted partition, and restore them otherwise. Must be called
+  //! with the slice's cpuset.cpus.exclusive locked.
+  static void park(std::string const& slice, CPUSet const& exclusive);
+  //! Apply the combined noise profiles of all isolated partitions to the
+  //! kernel tunables, and restore the tunables no profile adjusts anymore.
+  static void reduce_noise();
+  //! Steer each file recorded by a partition to the CPUs of all partitions
+  //! recording it, and restore the files no partition records anymore.
+  static void steer_net_queues();
+  //! Return the current reservations of slice.
+  static Reservations reservations(std::string const& slice, time_t now);
+  //! Throw a std::runtime_error if the partition's CPUs are reserved by
+  //! another process before it is expected to end.
+  void check_reservations(time_t now, time_t end) const;
+  //! Return the CPUs the partition may not use because of the anti-affinity
+  //! rules of its job class.
+  CPUSet conflicts(CPUTopology const& topology) const;
 
 public:
   ~CPUCGroup();
-  CPUCGroup(CPUSet const& set);
+  //! Create a partition for set in pool's slice, owned by the calling user.
+  //! The partition is expected to exist until end (0 if unknown), and may
+  //! only use CPUs not reserved by other processes until then.
+  //! If job_class is not empty, the partition is labeled with it, and may not
+  //! share the scope of the class's anti-affinity rule with partitions of the
+  //! same class.
+  //! \throw std::runtime_error if this would exceed quota, or if set is
+  //! reserved or violates an anti-affinity rule.
+  CPUCGroup(Pool const& pool, Quota const& quota, CPUSet const& set,
+            bool isolate = false, time_t end = 0,
+            std::string const& job_class = std::string());
+  //! Create a partition with count CPUs in pool's slice, selected according
+  //! to the pool's allocation policy among the CPUs allowed by the
+  //! anti-affinity rules.
+  CPUCGroup(Pool const& pool, Quota const& quota, int count,
+            CPUTopology const& topology, bool isolate = false,
+            time_t end = 0, std::string const& job_class = std::string());
+  //! Attach to the partition of the calling user's session name, which is
+  //! held by another process. The partition is left alone when the object is
+  //! destroyed.
+  //! \throw std::runtime_error if there is no such session.
+  explicit CPUCGroup(std::string const& session);
 
-  void add(pid_t pid);
+  CPUSet const& cpus() const
+  {
+    return mCPUSet;
+  }
 
-  void isolate(bool enable = true)
+  std::string const& path() const
   {
-    set_partition_type(enable ? "isolated" : "root");
+    return mPath;
   }
 
+  //! Allow compact() to move the partition. Only call this if nothing was
+  //! set up for the partition's current CPUs (e.g. their frequency), as it
+  //! would be left behind on the old CPUs.
+  void set_movable();
+
+  //! Make the partition the session name, held by the process holder.
+  void set_session(std::string const& name, pid_t holder);
+
+  //! Return whether any processes run in the partition.
+  bool populated() const;
+
+  //! Return whether the partition is the only one in any slice.
+  bool alone() const;
+
+  void add(pid_t pid);
+
+  //! Turn load balancing for the partition off or on. While the partition
+  //! is isolated, the kernel tunables are adjusted according to the pool's
+  //! noise profile.
+  void isolate(bool enable = true);
+
+  //! Mark the partition as boosted. While a boosted partition exists, the
+  //! free CPUs of the slice run at their lowest frequency, leaving more of
+  //! the package's power and thermal budget to the partitions.
+  void boost();
+
+  //! Steer the RPS/XPS and interrupt affinity files onto the partition's
+  //! CPUs, and stop steering the files it steered before. Files steered onto
+  //! several partitions use the CPUs of all of them, and are restored when
+  //! the last of them stops steering them.
+  void steer(std::vector<std::string> const& files);
+
   // Clone a child process into the cgroup using the clone3 system call.
   // The flags parameter can be used to add additional flags to the clone3
   // system call. The following flags can be added: CLONE_CLEAR_SIGHAND,
@@ -66,10 +198,48 @@ public:
   // checked for validity.
   pid_t clone(int flags = 0);
 
+  // Run fn in a child process inside the cgroup and return its exit status.
+  // The child keeps runexcl's privileges, so this is meant for measurements
+  // runexcl performs itself, not for running user commands.
+  int run(std::function<int()> const& fn);
+
   void wait_empty();
 
-  // runexcl.slice management
-  static CPUSet setupSlice();
+  // Slice management
+  static CPUSet setupSlice(Pool const& pool);
+
+  // Return the CPUs used by the partitions of user uid in all slices.
+  static Usage usage(uid_t uid);
+
+  //! Return the path of the partition of user uid's session name, and store
+  //! the pid of the process holding it in holder. Returns an empty string if
+  //! there is no such session, or its holder has died. A process that reused
+  //! the holder's pid is told apart by its start time.
+  static std::string find_session(std::string const& name, uid_t uid,
+                                  pid_t& holder);
+
+  //! Reserve set, or if set is empty, count CPUs selected according to the
+  //! pool's allocation policy, in pool's slice from start to end for the
+  //! calling process. Partitions of other processes cannot use the CPUs
+  //! during that time, and the reservation is released when the calling
+  //! process creates and removes its partition, or exits.
+  //! \throw std::runtime_error if the CPUs are reserved by another process
+  //! for an overlapping window, or the partition would exceed quota.
+  static Reservation reserve(Pool const& pool, Quota const& quota,
+                             CPUSet const& set, int count,
+                             CPUTopology const& topology, bool isolate,
+                             time_t start, time_t end);
+
+  //! Move the running partition of pool's slice whose move concentrates the
+  //! free CPUs the most (see CPUAllocator::defragment) to its new CPUs. The
+  //! partition is grown to both sets, its threads are moved to the
+  //! corresponding new CPUs, and it is shrunk to the new set. If
+  //! migrate_memory is true, the memory of its processes is migrated to the
+  //! NUMA nodes of the new CPUs as well. Only partitions marked movable (see
+  //! set_movable) and not holding reserved CPUs are moved. Returns the move,
+  //! or an empty move if no move helps.
+  static Move compact(Pool const& pool, CPUTopology const& topology,
+                      bool migrate_memory);
 };
 
 #endif // CPUCGroup_hpp
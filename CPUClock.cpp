@@ -0,0 +1,111 @@
+// CPUClock.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "CPUClock.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h> // Definition of SYS_* constants
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+CPUClock::~CPUClock()
+{
+  if (-1 != mFd)
+    ::close(mFd);
+}
+
+CPUClock::CPUClock()
+{
+  // Count the cycles of the calling thread on whatever CPU it runs. Cycles
+  // spent in the kernel are excluded, as we are only interested in the clock
+  // the spinning code sees.
+  struct perf_event_attr attr;
+  ::memset(&attr, 0, sizeof(attr));
+  attr.type           = PERF_TYPE_HARDWARE;
+  attr.size           = sizeof(attr);
+  attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+
+  mFd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+double CPUClock::now()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+unsigned long long CPUClock::cycles() const
+{
+  unsigned long long count = 0;
+  if (-1 == mFd)
+    throw std::system_error(ENOENT, std::system_category(),
+                            "perf_event_open(PERF_COUNT_HW_CPU_CYCLES)");
+  if (sizeof(count) != ::read(mFd, &count, sizeof(count)))
+    throw std::system_error(errno, std::system_category(),
+                            "read cycle counter");
+  return count;
+}
+
+double CPUClock::spin(double window)
+{
+  // The empty asm statement makes the compiler believe x is modified, so it
+  // can neither remove the loop nor combine the additions. This leaves a
+  // chain of dependent additions, each of which takes one cycle.
+  unsigned long iterations = 0;
+  double        start      = now();
+  double        end;
+  do {
+    unsigned long x = 0;
+    for (int i = 0; i < 1000; ++i) {
+      x += 1;
+      asm volatile("" : "+r"(x));
+    }
+    iterations += x;
+  } while ((end = now()) - start < window);
+
+  return iterations / (end - start);
+}
+
+double CPUClock::frequency(double window) const
+{
+  if (-1 == mFd)
+    return spin(window);
+
+  unsigned long long start_cycles = cycles();
+  double             start        = now();
+  double             end;
+  while ((end = now()) - start < window) {
+  }
+  unsigned long long end_cycles = cycles();
+
+  return (end_cycles - start_cycles) / (end - start);
+}
@@ -0,0 +1,57 @@
+// CPUClock.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef CPUClock_hpp
+#define CPUClock_hpp
+
+//! Measure the clock frequency the calling thread actually runs at by counting
+//! the CPU cycles it executes while spinning. If the kernel provides no cycle
+//! counter (e.g. inside some virtual machines), the iterations of a loop that
+//! executes about one instruction per cycle are counted instead, which gives
+//! an estimate that is good enough to observe frequency changes.
+class CPUClock
+{
+protected:
+  int mFd;
+
+  //! Spin for window seconds counting loop iterations.
+  static double spin(double window);
+
+public:
+  ~CPUClock();
+  //! Open a cycle counter for the calling thread.
+  CPUClock();
+
+  //! Return the current value of CLOCK_MONOTONIC in seconds.
+  static double now();
+
+  //! Return the number of cycles the calling thread has executed so far.
+  //! Throws std::system_error if there is no cycle counter.
+  unsigned long long cycles() const;
+
+  //! Spin for window seconds and return the clock frequency in Hz the calling
+  //! thread ran at during this time.
+  double frequency(double window) const;
+};
+
+#endif // CPUClock_hpp
@@ -42,9 +42,25 @@
 //
 
 #include "CPUGovernor.hpp"
+#include "CPUClock.hpp"
+#include "Config.hpp"
+#include "print.hpp"
 #include "sysfs.hpp"
 
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <map>
 #include <new>
+#include <ostream>
+#include <sstream>
+#include <system_error>
 #include <vector>
 
 
@@ -57,8 +73,115 @@
 //! Path to AMD amd_pstate
 #define PATH_AMD_PSTATE CPU_ROOT "/amd_pstate/status"
 
+//! File recording the frequency settings kept after their partition ended
+#define STICKY_STATE RUNEXCL_STATE "/cpufreq"
+
 namespace fs = std::filesystem;
 
+//! Original settings of a cpufreq policy.
+struct SavedPolicy
+{
+  std::string mGovernor;
+  std::string mSetSpeed;
+  int         mMaxFreq = 0;
+  int         mMinFreq = 0;
+  //! runexcl process using the changed settings, 0 if none.
+  pid_t mHolder = 0;
+  //! When to restore the settings if there is no holder.
+  time_t mRestore = 0;
+};
+
+//! The cpufreq settings kept in place after their partitions ended (see
+//! CPUGovernor::release), with their original values. The state is kept in
+//! STICKY_STATE, which is locked while the object exists.
+class StickyState
+{
+protected:
+  int mFd;
+
+public:
+  //! Original settings of the policies, by path.
+  std::map<std::string, SavedPolicy> mPolicies;
+  //! Original operating mode of the driver, empty if unchanged.
+  std::string mStatus;
+
+  //! Lock and read the state. If create is false and there is no state,
+  //! nothing is locked.
+  StickyState(bool create = true) : mFd(-1)
+  {
+    if (create && ::mkdir(RUNEXCL_STATE, S_IRWXU | S_IRGRP | S_IXGRP |
+                                             S_IROTH | S_IXOTH) &&
+        (EEXIST != errno))
+      throw std::system_error(errno, std::system_category(),
+                              "mkdir(" RUNEXCL_STATE ")");
+    mFd = ::open(STICKY_STATE, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0),
+                 S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (-1 == mFd) {
+      if (!create && (ENOENT == errno))
+        return;
+      throw std::system_error(errno, std::system_category(),
+                              "open(" STICKY_STATE ")");
+    }
+    while (::flock(mFd, LOCK_EX)) {
+      if (EINTR != errno) {
+        ::close(mFd);
+        throw std::system_error(errno, std::system_category(), "flock");
+      }
+    }
+
+    std::string text;
+    char        buffer[4096];
+    for (ssize_t n; (n = ::read(mFd, buffer, sizeof(buffer))) > 0;)
+      text.append(buffer, n);
+
+    std::istringstream in(text);
+    for (std::string type; in >> type;) {
+      if ("status" == type) {
+        in >> mStatus;
+      }
+      else {
+        std::string path;
+        SavedPolicy saved;
+        long long   restore;
+        in >> path >> saved.mGovernor >> saved.mSetSpeed >> saved.mMaxFreq >>
+            saved.mMinFreq >> saved.mHolder >> restore;
+        saved.mRestore   = restore;
+        mPolicies[path] = saved;
+      }
+    }
+  }
+
+  ~StickyState()
+  {
+    if (-1 != mFd)
+      ::close(mFd);
+  }
+
+  //! Return false if there was no state to read.
+  bool exists() const
+  {
+    return -1 != mFd;
+  }
+
+  void save()
+  {
+    std::string text;
+    if (!mStatus.empty())
+      text += "status " + mStatus + "\n";
+    for (auto const& entry : mPolicies) {
+      SavedPolicy const& saved = entry.second;
+      text += "policy " + entry.first + " " + saved.mGovernor + " " +
+              saved.mSetSpeed + " " + std::to_string(saved.mMaxFreq) + " " +
+              std::to_string(saved.mMinFreq) + " " +
+              std::to_string(saved.mHolder) + " " +
+              std::to_string((long long)saved.mRestore) + "\n";
+    }
+    if (::ftruncate(mFd, 0) ||
+        (::pwrite(mFd, text.data(), text.size(), 0) != (ssize_t)text.size()))
+      throw std::system_error(errno, std::system_category(),
+                              "write(" STICKY_STATE ")");
+  }
+};
 
 class CPUPolicy
 {
@@ -68,35 +191,128 @@ protected:
   std::string mScalingSetSpeed;
   int         mScalingMaxFreq;
   int         mScalingMinFreq;
+  bool        mUserspace;
+  bool        mGovernorChanged;
+  bool        mLimitsChanged;
+  bool        mKeep;
+  int         mSpeed;
 
 public:
-  CPUPolicy(fs::path path) : mPath(path)
+  CPUPolicy(fs::path path)
+    : mPath(path), mGovernorChanged(false), mLimitsChanged(false),
+      mKeep(false)
   {
     // Get some data.
     mScalingGovernor = sysfs_read(mPath / "scaling_governor");
     mScalingSetSpeed = sysfs_read(mPath / "scaling_setspeed");
     mScalingMaxFreq  = std::stoi(sysfs_read(mPath / "scaling_max_freq"));
     mScalingMinFreq  = std::stoi(sysfs_read(mPath / "scaling_min_freq"));
+    mSpeed           = mScalingMaxFreq;
+
+    // Not every driver supports the userspace governor (e.g. amd_pstate in
+    // active mode doesn't).
+    std::vector<std::string> governors =
+        sysfs_read_words(mPath / "scaling_available_governors");
+    mUserspace = governors.end() !=
+                 std::find(governors.begin(), governors.end(), "userspace");
   }
 
   virtual ~CPUPolicy()
   {
+    if (mKeep)
+      return;
+
     try {
+      if (mLimitsChanged) {
+        sysfs_write(mPath / "scaling_max_freq", mScalingMaxFreq);
+        sysfs_write(mPath / "scaling_min_freq", mScalingMinFreq);
+      }
+
       if (mScalingSetSpeed != "<unsupported>")
         sysfs_write(mPath / "scaling_setspeed", mScalingSetSpeed);
 
-      sysfs_write(mPath / "scaling_governor", mScalingGovernor);
+      if (mGovernorChanged)
+        sysfs_write(mPath / "scaling_governor", mScalingGovernor);
     }
     catch (std::exception& e) {
-      std::cerr << e.what() << '\n';
+      print(2, "%s\n", e.what());
     }
   }
 
-  virtual void set_frequency(double freq)
+  fs::path const& path() const
   {
-    // First, we must set the governor to 'userspace'.
-    sysfs_write(mPath / "scaling_governor", "userspace");
+    return mPath;
+  }
 
+  //! Return the original settings.
+  SavedPolicy saved() const
+  {
+    SavedPolicy saved;
+    saved.mGovernor = mScalingGovernor;
+    saved.mSetSpeed = mScalingSetSpeed;
+    saved.mMaxFreq  = mScalingMaxFreq;
+    saved.mMinFreq  = mScalingMinFreq;
+    return saved;
+  }
+
+  //! Take over settings kept from a previous partition, so that settings
+  //! that are already in place aren't changed again, and saved is restored
+  //! eventually.
+  void adopt(SavedPolicy const& saved)
+  {
+    mGovernorChanged = mScalingGovernor != saved.mGovernor;
+    mLimitsChanged   = (mScalingMaxFreq != saved.mMaxFreq) ||
+                     (mScalingMinFreq != saved.mMinFreq);
+    mScalingGovernor = saved.mGovernor;
+    mScalingSetSpeed = saved.mSetSpeed;
+    mScalingMaxFreq  = saved.mMaxFreq;
+    mScalingMinFreq  = saved.mMinFreq;
+  }
+
+  //! Leave the settings in place when the policy is destroyed.
+  void keep()
+  {
+    mKeep = true;
+  }
+
+  //! Restore the settings saved for the policy at path.
+  static void restore(fs::path const& path, SavedPolicy const& saved)
+  {
+    // The kernel won't accept a minimum above the current maximum or vice
+    // versa, so the order of the limits matters.
+    if (saved.mMaxFreq >= std::stoi(sysfs_read(path / "scaling_min_freq"))) {
+      sysfs_write(path / "scaling_max_freq", saved.mMaxFreq);
+      sysfs_write(path / "scaling_min_freq", saved.mMinFreq);
+    }
+    else {
+      sysfs_write(path / "scaling_min_freq", saved.mMinFreq);
+      sysfs_write(path / "scaling_max_freq", saved.mMaxFreq);
+    }
+    if (saved.mSetSpeed != "<unsupported>")
+      sysfs_write(path / "scaling_setspeed", saved.mSetSpeed);
+    sysfs_write(path / "scaling_governor", saved.mGovernor);
+  }
+
+  //! Frequency in kHz the policy was last set to.
+  int speed() const
+  {
+    return mSpeed;
+  }
+
+  //! Lowest frequency in kHz the policy allows.
+  int min_frequency() const
+  {
+    return mScalingMinFreq;
+  }
+
+  //! Highest frequency in kHz the policy allows.
+  int max_frequency() const
+  {
+    return mScalingMaxFreq;
+  }
+
+  virtual void set_frequency(double freq)
+  {
     int _freq = mScalingMinFreq;
     if (freq > 1.0) {
       // The scaling governor expects the frequency to be in kHz.
@@ -112,8 +328,36 @@ public:
       _freq = (int)mScalingMinFreq;
     }
 
-    sysfs_write(mPath / "scaling_setspeed",
-                _freq < mScalingMinFreq ? mScalingMinFreq : _freq);
+    set_speed(_freq < mScalingMinFreq ? mScalingMinFreq : _freq);
+  }
+
+  //! Set the frequency to freq kHz.
+  void set_speed(int freq)
+  {
+    if (mUserspace) {
+      // First, we must set the governor to 'userspace'.
+      if (!mGovernorChanged) {
+        sysfs_write(mPath / "scaling_governor", "userspace");
+        mGovernorChanged = true;
+      }
+
+      sysfs_write(mPath / "scaling_setspeed", freq);
+    }
+    else {
+      // Without the userspace governor, pin the frequency by setting both
+      // limits to it. The order matters, as the kernel won't accept a minimum
+      // above the current maximum or vice versa.
+      mLimitsChanged = true;
+      if (freq > mSpeed) {
+        sysfs_write(mPath / "scaling_max_freq", freq);
+        sysfs_write(mPath / "scaling_min_freq", freq);
+      }
+      else {
+        sysfs_write(mPath / "scaling_min_freq", freq);
+        sysfs_write(mPath / "scaling_max_freq", freq);
+      }
+    }
+    mSpeed = freq;
   }
 };
 
@@ -121,6 +365,7 @@ class CPUPerformanceDriver
 {
 protected:
   std::vector<CPUPolicy*> mPolicies;
+  bool                    mKeep = false;
 
 public:
   CPUPerformanceDriver() {}
@@ -148,11 +393,10 @@ public:
       // It would be nice if we could use CPUSet's operator>> to read the CPU
       // set. Unfortunately, this is Linux, so the CPU frequence stuff uses
       // a different format.
-      std::ifstream in(dir_entry.path() / "affected_cpus");
-      while (in.good()) {
-        int cpu;
-        in >> cpu;
-        if (in.fail() || (cpu < 0) || (cpu >= set.max_cpus())) {
+      for (std::string const& word :
+           sysfs_read_words(dir_entry.path() / "affected_cpus")) {
+        int cpu = std::stoi(word);
+        if ((cpu < 0) || (cpu >= set.max_cpus())) {
           break;
         }
         else if (set.is_set(cpu)) {
@@ -167,11 +411,56 @@ public:
   void set_frequency(CPUSet const& set, double freq)
   {
     setup_policies(set);
+    set_frequency(freq);
+  }
+
+  //! Set the frequency of the policies set up.
+  void set_frequency(double freq)
+  {
     for (CPUPolicy* policy : mPolicies)
       policy->set_frequency(freq);
   }
 
-  static CPUPerformanceDriver* create();
+  std::vector<CPUPolicy*> const& policies() const
+  {
+    return mPolicies;
+  }
+
+  //! Return the original operating mode of the driver, or nullptr if the
+  //! driver has no modes.
+  virtual std::string* status()
+  {
+    return nullptr;
+  }
+
+  //! Leave the settings in place when the driver is destroyed.
+  void keep()
+  {
+    mKeep = true;
+    for (CPUPolicy* policy : mPolicies)
+      policy->keep();
+  }
+
+  //! Return the policy for cpu, or nullptr if it is not set up.
+  CPUPolicy* policy(int cpu) const
+  {
+    fs::path path = fs::canonical(fs::path(CPU_ROOT) /
+                                  ("cpu" + std::to_string(cpu)) / "cpufreq");
+    for (CPUPolicy* policy : mPolicies) {
+      if (fs::canonical(policy->path()) == path)
+        return policy;
+    }
+    return nullptr;
+  }
+
+  void measure_transition_latency(int cpu, int samples, std::ostream& out);
+
+  //! Return the operating modes of the system's performance scaling driver.
+  static std::vector<std::string> modes();
+  //! Return the current operating mode (empty if there is only one).
+  static std::string mode();
+  //! Create the driver for the given mode (the first mode if empty).
+  static CPUPerformanceDriver* create(std::string const& mode = "");
 };
 
 //
@@ -205,22 +494,44 @@ protected:
   std::string mStatus;
 
 public:
-  CPUAMDPStatePerformanceDriver() : CPUPerformanceDriver()
+  CPUAMDPStatePerformanceDriver(std::string const& mode = "passive")
+    : CPUPerformanceDriver()
   {
     // Get the original status of the amd_pstate governor, then set it to
-    // passive.
-    mStatus = sysfs_change(PATH_AMD_PSTATE, "passive");
+    // passive (or the requested mode). Changing the status re-registers the
+    // driver, which takes a while, so don't do it if it isn't necessary.
+    mStatus = sysfs_read(PATH_AMD_PSTATE);
+    if (mStatus != mode)
+      sysfs_write(PATH_AMD_PSTATE, mode);
   }
 
   ~CPUAMDPStatePerformanceDriver() override
   {
-    // We need to clear the policies vector before restoring the original state
-    // of PATH_AMD_PSTATE, as the policy information is saved after we've set
-    // PATH_AMD_PSTATE to 'passive'.
-    mPolicies.clear();
+    if (mKeep)
+      return;
+
+    // Restoring the original state of PATH_AMD_PSTATE re-registers the
+    // driver, which resets all policies, so their settings (saved after we
+    // changed the state) must not be restored afterwards. If the state is
+    // unchanged, the base class deletes the policies, which restores them.
+    try {
+      if (sysfs_read(PATH_AMD_PSTATE) != mStatus) {
+        for (CPUPolicy* policy : mPolicies) {
+          policy->keep();
+          delete policy;
+        }
+        mPolicies.clear();
+        sysfs_write(PATH_AMD_PSTATE, mStatus);
+      }
+    }
+    catch (std::exception& e) {
+      print(2, "%s\n", e.what());
+    }
+  }
 
-    // Restore original state of PATH_AMD_PSTATE.
-    sysfs_write(PATH_AMD_PSTATE, mStatus);
+  std::string* status() override
+  {
+    return &mStatus;
   }
 
   CPUAMDPStatePolicy* createPolicy(fs::path path) override
@@ -233,23 +544,308 @@ public:
 // Create the correct CPUPerformanceDriver subclass for the system.
 //
 
-CPUPerformanceDriver* CPUPerformanceDriver::create()
+std::vector<std::string> CPUPerformanceDriver::modes()
 {
   if (fs::exists(PATH_AMD_PSTATE))
-    return new CPUAMDPStatePerformanceDriver();
+    return {"passive", "guided", "active"};
+  else
+    return {""};
+}
+
+std::string CPUPerformanceDriver::mode()
+{
+  if (fs::exists(PATH_AMD_PSTATE))
+    return sysfs_read(PATH_AMD_PSTATE);
+  else
+    return "";
+}
+
+CPUPerformanceDriver* CPUPerformanceDriver::create(std::string const& mode)
+{
+  if (fs::exists(PATH_AMD_PSTATE))
+    return new CPUAMDPStatePerformanceDriver(mode.empty() ? "passive" : mode);
   else
     return new CPUPerformanceDriver();
 }
 
+//
+// Frequency transition latency measurement
+//
+
+//! Length of the window over which the clock frequency is sampled. This is
+//! also the resolution of the latency measurement.
+#define SAMPLE_WINDOW 20e-6
+
+//! Maximum time to wait for a frequency change to take effect.
+#define TRANSITION_TIMEOUT 0.1
+
+//! Sample the clock frequency until it crosses threshold (from below if rising
+//! is true, from above otherwise) and return the time since start, or -1.0 if
+//! that doesn't happen within TRANSITION_TIMEOUT.
+static double wait_for_frequency(CPUClock const& clock, double start,
+                                 double threshold, bool rising)
+{
+  while (true) {
+    double freq = clock.frequency(SAMPLE_WINDOW);
+    double t    = CPUClock::now() - start;
+    if (rising ? (freq >= threshold) : (freq <= threshold))
+      return t;
+    if (t > TRANSITION_TIMEOUT)
+      return -1.0;
+  }
+}
+
+//! Print the distribution of the latencies (in seconds) in samples.
+static void print_latencies(std::ostream& out, char const* label,
+                            std::vector<double> samples)
+{
+  size_t total = samples.size();
+  samples.erase(std::remove(samples.begin(), samples.end(), -1.0),
+                samples.end());
+  std::sort(samples.begin(), samples.end());
+
+  out << "  " << label << ": ";
+  if (samples.empty()) {
+    out << "no transition observed\n";
+    return;
+  }
+
+  auto percentile = [&](double p) {
+    return samples[(size_t)(p * (samples.size() - 1) + 0.5)] * 1e6;
+  };
+  out << "min " << percentile(0.0) << " us, median " << percentile(0.5)
+      << " us, p90 " << percentile(0.9) << " us, p99 " << percentile(0.99)
+      << " us, max " << percentile(1.0) << " us";
+  if (samples.size() != total)
+    out << ", " << (total - samples.size()) << " of " << total << " timed out";
+  out << '\n';
+}
+
+void CPUPerformanceDriver::measure_transition_latency(int cpu, int samples,
+                                                      std::ostream& out)
+{
+  fs::path path = fs::canonical(fs::path(CPU_ROOT) /
+                                ("cpu" + std::to_string(cpu)) / "cpufreq");
+  CPUPolicy* policy = createPolicy(path);
+  mPolicies.push_back(policy);
+
+  std::string driver = sysfs_read(path / "scaling_driver");
+  CPUClock    clock;
+
+  // The frequencies the CPU actually reaches may differ from the nominal
+  // ones (e.g. because the maximum includes boost frequencies that cannot
+  // always be reached), so determine them first and use them to derive the
+  // thresholds that indicate a transition has taken effect.
+  policy->set_speed(policy->max_frequency());
+  clock.frequency(TRANSITION_TIMEOUT);
+  double high = clock.frequency(0.01);
+  policy->set_speed(policy->min_frequency());
+  clock.frequency(TRANSITION_TIMEOUT);
+  double low = clock.frequency(0.01);
+
+  out << driver << ": " << (int)(low / 1e6) << " MHz <-> "
+      << (int)(high / 1e6) << " MHz\n";
+  if (high < low * 1.05) {
+    out << "  frequency changes not observable\n";
+    return;
+  }
+
+  double rising  = low + 0.9 * (high - low);
+  double falling = low + 0.1 * (high - low);
+
+  std::vector<double> up, down;
+  for (int i = 0; i < samples; ++i) {
+    double start = CPUClock::now();
+    policy->set_speed(policy->max_frequency());
+    up.push_back(wait_for_frequency(clock, start, rising, true));
+    clock.frequency(0.001);
+
+    start = CPUClock::now();
+    policy->set_speed(policy->min_frequency());
+    down.push_back(wait_for_frequency(clock, start, falling, false));
+    clock.frequency(0.001);
+  }
+
+  print_latencies(out, "up", up);
+  print_latencies(out, "down", down);
+}
+
 //
 // Public interface
 //
 
-CPUGovernor::CPUGovernor() : mImpl(nullptr) {}
+CPUGovernor::CPUGovernor(double grace)
+  : mImpl(nullptr), mGrace(grace), mHolder(::getpid())
+{
+}
 
 CPUGovernor::~CPUGovernor()
 {
-  delete mImpl;
+  try {
+    release();
+  }
+  catch (const std::exception& e) {
+    print(2, "%s\n", e.what());
+  }
+}
+
+double CPUGovernor::release()
+{
+  if (!mImpl)
+    return -1.0;
+
+  // Hand the settings over to the sticky state, and restore those that are
+  // due, which includes ours if there is no grace period.
+  {
+    StickyState state;
+    time_t      restore = ::time(nullptr) + (time_t)mGrace;
+    for (CPUPolicy* policy : mImpl->policies()) {
+      auto it = state.mPolicies.find(policy->path().string());
+      if (it == state.mPolicies.end())
+        it = state.mPolicies.emplace(policy->path().string(), policy->saved())
+                 .first;
+      else if (it->second.mHolder != mHolder)
+        continue; // Somebody else uses the policy now.
+      it->second.mHolder  = 0;
+      it->second.mRestore = restore;
+    }
+    std::string* status = mImpl->status();
+    if (status && state.mStatus.empty() &&
+        (sysfs_read(PATH_AMD_PSTATE) != *status))
+      state.mStatus = *status;
+    state.save();
+
+    mImpl->keep();
+    delete mImpl;
+    mImpl = nullptr;
+  }
+
+  return restore_idle();
+}
+
+double CPUGovernor::restore_idle()
+{
+  StickyState state(false);
+  time_t      now  = ::time(nullptr);
+  double      next = -1.0;
+  for (auto it = state.mPolicies.begin(); it != state.mPolicies.end();) {
+    SavedPolicy& saved = it->second;
+
+    // The holder may have died without releasing the policy.
+    if (saved.mHolder && ::kill(saved.mHolder, 0) && (ESRCH == errno)) {
+      saved.mHolder  = 0;
+      saved.mRestore = now;
+    }
+
+    if (saved.mHolder) {
+      ++it;
+    }
+    else if (saved.mRestore > now) {
+      double wait = saved.mRestore - now;
+      next        = ((next < 0.0) || (wait < next)) ? wait : next;
+      ++it;
+    }
+    else {
+      // A policy that can't be restored is dropped, or it would be retried
+      // forever.
+      try {
+        CPUPolicy::restore(it->first, saved);
+      }
+      catch (const std::exception& e) {
+        print(2, "%s\n", e.what());
+      }
+      it = state.mPolicies.erase(it);
+    }
+  }
+
+  // Changing the driver's mode resets all policies, so it is restored after
+  // the last policy.
+  if (state.mPolicies.empty() && !state.mStatus.empty()) {
+    if (sysfs_read(PATH_AMD_PSTATE) != state.mStatus)
+      sysfs_write(PATH_AMD_PSTATE, state.mStatus);
+    state.mStatus.clear();
+  }
+
+  if (state.exists())
+    state.save();
+  return next;
+}
+
+void CPUGovernor::restore(CPUSet const& set)
+{
+  {
+    StickyState state(false);
+    bool        due = false;
+    for (auto& entry : state.mPolicies) {
+      // A policy that vanished (e.g. with its CPUs going offline) is left
+      // to restore_idle().
+      std::vector<std::string> cpus;
+      try {
+        cpus = sysfs_read_words(fs::path(entry.first) / "affected_cpus");
+      }
+      catch (std::system_error const&) {
+      }
+      for (std::string const& word : cpus) {
+        int cpu = std::stoi(word);
+        if ((cpu >= 0) && (cpu < set.max_cpus()) && set.is_set(cpu)) {
+          entry.second.mRestore = 0;
+          due                   = true;
+        }
+      }
+    }
+    if (!due)
+      return;
+    state.save();
+  }
+  restore_idle();
+}
+
+double CPUGovernor::target_frequency(int cpu) const
+{
+  try {
+    CPUPolicy* policy = mImpl ? mImpl->policy(cpu) : nullptr;
+    if (policy)
+      return policy->speed() * 1000.0;
+
+    fs::path path = fs::path(CPU_ROOT) / ("cpu" + std::to_string(cpu)) /
+                    "cpufreq/scaling_max_freq";
+    if (fs::exists(path))
+      return std::stod(sysfs_read(path)) * 1000.0;
+  }
+  catch (const std::exception& e) {
+    print(2, "%s\n", e.what());
+  }
+  return 0.0;
+}
+
+std::vector<std::string> CPUGovernor::modes()
+{
+  return CPUPerformanceDriver::modes();
+}
+
+std::string CPUGovernor::mode()
+{
+  return CPUPerformanceDriver::mode();
+}
+
+void CPUGovernor::measure_transition_latency(int cpu, int samples,
+                                             std::string const& mode,
+                                             std::ostream&      out)
+{
+  // A mode that cannot be measured is reported, so that the caller can go on
+  // measuring the others.
+  CPUPerformanceDriver* driver = nullptr;
+  try {
+    if (!(driver = CPUPerformanceDriver::create(mode)))
+      throw std::bad_alloc();
+    if (!mode.empty())
+      out << "[" << mode << "] ";
+    driver->measure_transition_latency(cpu, samples, out);
+  }
+  catch (const std::exception& e) {
+    out << "  measurement failed: " << e.what() << '\n';
+  }
+  delete driver;
 }
 
 void CPUGovernor::set_frequency(CPUSet const& set, double freq)
@@ -258,13 +854,29 @@ void CPUGovernor::set_frequency(CPUSet const& set, double freq)
   mImpl = nullptr;
 
   try {
+    // Take over the settings kept from previous partitions, so that we only
+    // change what differs, and the original settings are restored in the
+    // end.
+    StickyState state;
     if (!(mImpl = CPUPerformanceDriver::create()))
       throw std::bad_alloc();
 
-    mImpl->set_frequency(set, freq);
+    mImpl->setup_policies(set);
+    if (mImpl->status() && !state.mStatus.empty())
+      *mImpl->status() = state.mStatus;
+    for (CPUPolicy* policy : mImpl->policies()) {
+      auto it = state.mPolicies.find(policy->path().string());
+      if (it == state.mPolicies.end())
+        continue;
+      policy->adopt(it->second);
+      it->second.mHolder = mHolder;
+    }
+    state.save();
+
+    mImpl->set_frequency(freq);
   }
   catch (const std::exception& e) {
-    std::cerr << "Failed to set CPU frequency: " << e.what() << '\n';
+    print(2, "Failed to set CPU frequency: %s\n", e.what());
     delete mImpl;
     mImpl = nullptr;
   }
@@ -26,6 +26,12 @@
 
 #include "CPUSet.hpp"
 
+#include <sys/types.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
 // Forward declaration
 class CPUPerformanceDriver;
 
@@ -33,12 +39,56 @@ class CPUGovernor
 {
 protected:
   CPUPerformanceDriver* mImpl;
+  double                mGrace;
+  pid_t                 mHolder;
 
 public:
-  CPUGovernor();
+  //! Create a governor that restores the settings it changed grace seconds
+  //! after it is released, unless they are taken over by another governor
+  //! asking for the same CPUs in the meantime.
+  CPUGovernor(double grace = 0.0);
   ~CPUGovernor();
 
+  //! Release the settings, and restore those that are due (see
+  //! restore_idle).
+  //! \return The number of seconds until more settings are due to be
+  //! restored, or -1.0 if none are pending.
+  double release();
+
+  //! Restore the settings released by governors whose grace period has
+  //! passed.
+  //! \return The number of seconds until more settings are due, or -1.0 if
+  //! none are pending.
+  static double restore_idle();
+
+  //! Restore the released settings of the CPUs in set now, e.g. because they
+  //! are used by a partition that doesn't change their frequency.
+  static void restore(CPUSet const& set);
+
   void set_frequency(CPUSet const& set, double freq);
+
+  //! Return the frequency in Hz cpu should run at when busy, i.e. the
+  //! frequency set with set_frequency, or the highest frequency the cpufreq
+  //! policy allows if set_frequency was not called for cpu. Returns 0.0 if
+  //! the frequency cannot be determined.
+  double target_frequency(int cpu) const;
+
+  //! Return the operating modes of the cpufreq driver, e.g. 'passive',
+  //! 'guided', and 'active' for amd_pstate, or just an empty string if the
+  //! driver has no modes.
+  static std::vector<std::string> modes();
+  //! Return the current operating mode of the cpufreq driver.
+  static std::string mode();
+
+  //! Measure how long it takes until a frequency change written to the
+  //! cpufreq policy of cpu takes effect, by toggling between the lowest and
+  //! highest frequency samples times with the cpufreq driver in mode, and
+  //! print the distribution of the latencies to out. Switching the mode
+  //! affects all CPUs. Must be called from a thread pinned to cpu, and
+  //! restores the original settings afterwards.
+  static void measure_transition_latency(int cpu, int samples,
+                                         std::string const& mode,
+                                         std::ostream&      out);
 };
 
 #endif // CPUGovernor_hpp
\ No newline at end of file
@@ -25,8 +25,11 @@
 #include "CPUSet.hpp"
 
 #include <climits>
+#include <cstdint>
 #include <cstdlib>
+#include <istream>
 #include <new>
+#include <ostream>
 #include <stdexcept>
 #include <system_error>
 
@@ -95,18 +98,40 @@ CPUSet::CPUSet(pid_t pid) : CPUSet()
 
 int CPUSet::first() const
 {
-  for (int i = 0; i < mMaxCPUs; ++i) {
-    if (is_set(i))
-      return i;
+  // Skip empty words of the mask instead of testing every CPU.
+  size_t words = mSize / sizeof(__cpu_mask);
+  for (size_t i = 0; i < words; ++i) {
+    if (mSet->__bits[i])
+      return i * __NCPUBITS + __builtin_ctzl(mSet->__bits[i]);
   }
   return -1;
 }
 
+int CPUSet::next(int cpu) const
+{
+  assert(cpu >= -1);
+  size_t words = mSize / sizeof(__cpu_mask);
+  size_t i     = (cpu + 1) / __NCPUBITS;
+  if (i >= words)
+    return -1;
+
+  // Mask the CPUs up to and including cpu in the first word.
+  __cpu_mask bits = mSet->__bits[i];
+  bits &= ~__cpu_mask(0) << ((cpu + 1) % __NCPUBITS);
+  while (!bits) {
+    if (++i >= words)
+      return -1;
+    bits = mSet->__bits[i];
+  }
+  return i * __NCPUBITS + __builtin_ctzl(bits);
+}
+
 int CPUSet::last() const
 {
-  for (int i = mMaxCPUs - 1; i >= 0; --i) {
-    if (is_set(i))
-      return i;
+  for (size_t i = mSize / sizeof(__cpu_mask); i-- > 0;) {
+    if (mSet->__bits[i])
+      return i * __NCPUBITS + (__NCPUBITS - 1) -
+             __builtin_clzl(mSet->__bits[i]);
   }
   return -1;
 }
@@ -205,6 +230,34 @@ std::string CPUSet::to_string() const
   return result;
 }
 
+std::string CPUSet::to_mask() const
+{
+  std::string result;
+
+  // Only output as many 32 bit groups as are necessary to hold the highest
+  // CPU in the set, but at least one.
+  int groups = (last() + 32) / 32;
+  if (groups < 1)
+    groups = 1;
+
+  for (int group = groups - 1; group >= 0; --group) {
+    uint32_t bits = 0;
+    for (int bit = 0; bit < 32; ++bit) {
+      int n = group * 32 + bit;
+      if ((n < mMaxCPUs) && is_set(n))
+        bits |= uint32_t(1) << bit;
+    }
+
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%08x", bits);
+    result += buffer;
+    if (group)
+      result.push_back(',');
+  }
+
+  return result;
+}
+
 // Note that just like the standard library, we do not attempt to reset the
 // input position in the stream in case parsing of the CPUSet fails.
 // \note operator>> does not do exactly the same thing as parse() because
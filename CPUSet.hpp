@@ -29,7 +29,7 @@
 #include <cassert>
 #include <cstdio>
 #include <cstring>
-#include <iostream>
+#include <iosfwd>
 #include <string>
 #include <system_error>
 
@@ -126,6 +126,18 @@ public:
     return CPU_COUNT_S(mSize, mSet);
   }
 
+  //! Return the number of CPUs in both this set and mask.
+  int count(CPUSet const& mask) const
+  {
+    assert(mSize == mask.mSize);
+    int n = 0;
+    for (size_t i = 0; i < mSize / sizeof(__cpu_mask); ++i) {
+      if (mask.mSet->__bits[i])
+        n += __builtin_popcountl(mSet->__bits[i] & mask.mSet->__bits[i]);
+    }
+    return n;
+  }
+
   bool empty() const
   {
     return 0 == count();
@@ -133,6 +145,8 @@ public:
 
   int first() const;
   int last() const;
+  //! Return the lowest CPU in the set above cpu, or -1 if there is none.
+  int next(int cpu) const;
 
   CPUSet& operator&=(CPUSet const& rhs)
   {
@@ -200,6 +214,11 @@ public:
 
   std::string to_string() const;
 
+  //! Return the set in the kernel's hexadecimal bitmap format, i.e. groups of
+  //! 32 bits separated by commas with the most significant group first, as
+  //! used by e.g. /sys/class/net/<if>/queues/rx-<n>/rps_cpus.
+  std::string to_mask() const;
+
   void getaffinity(pid_t pid = 0)
   {
     if (sched_getaffinity(pid, mSize, mSet))
@@ -0,0 +1,299 @@
+// CPUTopology.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+// See https://docs.kernel.org/admin-guide/cputopology.html for a description
+// of the topology information in sysfs.
+
+#include "CPUTopology.hpp"
+#include "sysfs.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+//! Read a CPU list from path, returning an empty set if the file does not
+//! exist.
+static CPUSet read_list(fs::path const& path)
+{
+  if (!fs::exists(path))
+    return CPUSet();
+  return CPUSet(sysfs_read(path));
+}
+
+// Read a CPU list set at boot time from path. These files are empty if the
+// parameter wasn't given, but older kernels show '(null)' instead.
+static CPUSet read_boot_list(fs::path const& path)
+{
+  try {
+    return read_list(path);
+  }
+  catch (std::invalid_argument const&) {
+    return CPUSet();
+  }
+}
+
+CPUTopology::CPUTopology()
+{
+  CPUSet present = read_list(CPU_ROOT "/online");
+  mCPUs.resize(present.last() + 1);
+
+  for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+    if (!present.is_set(cpu))
+      continue;
+
+    fs::path path = fs::path(CPU_ROOT) / ("cpu" + std::to_string(cpu));
+
+    // core_cpus_list used to be called thread_siblings_list.
+    CPUSet core = read_list(path / "topology/core_cpus_list");
+    if (core.empty())
+      core = read_list(path / "topology/thread_siblings_list");
+    mCPUs[cpu].mCore = core.empty() ? cpu : core.first();
+
+    // Use the highest level cache as last level cache.
+    int    level = 0;
+    CPUSet llc;
+    for (int index = 0;; ++index) {
+      fs::path cache = path / "cache" / ("index" + std::to_string(index));
+      if (!fs::exists(cache))
+        break;
+      int l = std::stoi(sysfs_read(cache / "level"));
+      if (l > level) {
+        level = l;
+        llc   = read_list(cache / "shared_cpu_list");
+      }
+    }
+    mCPUs[cpu].mLLC  = llc.empty() ? -2 : llc.first();
+    mCPUs[cpu].mNode = 0;
+  }
+
+  // Assign the NUMA nodes. Systems without NUMA support don't have NODE_ROOT,
+  // in which case all CPUs are in node 0.
+  CPUSet online_nodes = read_list(NODE_ROOT "/online");
+  for (int n = 0; n <= online_nodes.last(); ++n) {
+    if (!online_nodes.is_set(n))
+      continue;
+    CPUSet cpus = read_list(fs::path(NODE_ROOT) /
+                            ("node" + std::to_string(n)) / "cpulist");
+    for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+      if (online(cpu) && cpus.is_set(cpu))
+        mCPUs[cpu].mNode = n;
+    }
+  }
+
+  // CPUs without cache information share a last level cache with the other
+  // CPUs of their node.
+  for (CPU& cpu : mCPUs) {
+    if (-2 == cpu.mLLC) {
+      CPUSet same = node(cpu.mNode);
+      cpu.mLLC    = same.first();
+    }
+  }
+
+  mIsolated = read_boot_list(CPU_ROOT "/isolated");
+  mNohzFull = read_boot_list(CPU_ROOT "/nohz_full");
+
+  // Measured clusters take the place of the last level caches. A cache that
+  // cannot be used is ignored, as the sysfs topology is still valid.
+  try {
+    load_clusters(read_file(TOPOLOGY_CACHE));
+  }
+  catch (std::system_error const&) {
+  }
+  catch (std::invalid_argument const&) {
+  }
+
+  sort();
+}
+
+CPUTopology::CPUTopology(int nodes, int llcs_per_node, int cores_per_llc,
+                         int threads_per_core)
+{
+  int cores = nodes * llcs_per_node * cores_per_llc;
+  mCPUs.resize(cores * threads_per_core);
+  for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+    int core         = cpu % cores;
+    int llc          = core / cores_per_llc;
+    mCPUs[cpu].mCore = core;
+    mCPUs[cpu].mLLC  = llc * cores_per_llc;
+    mCPUs[cpu].mNode = llc / llcs_per_node;
+  }
+
+  sort();
+}
+
+void CPUTopology::sort()
+{
+  mOrder.clear();
+  for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+    if (online(cpu))
+      mOrder.push_back(cpu);
+  }
+  std::sort(mOrder.begin(), mOrder.end(), [this](int a, int b) {
+    CPU const& x = mCPUs[a];
+    CPU const& y = mCPUs[b];
+    if (x.mNode != y.mNode)
+      return x.mNode < y.mNode;
+    if (x.mLLC != y.mLLC)
+      return x.mLLC < y.mLLC;
+    if (x.mCore != y.mCore)
+      return x.mCore < y.mCore;
+    return a < b;
+  });
+}
+
+bool CPUTopology::load_clusters(std::string const& text)
+{
+  std::istringstream  in(text);
+  std::vector<CPUSet> clusters;
+  bool                match = false;
+  for (std::string line; std::getline(in, line);) {
+    std::istringstream fields(line);
+    std::string        key, list;
+    if (!(fields >> key) || ('#' == key[0]) || ("latency" == key))
+      continue;
+    if (!(fields >> list))
+      throw std::invalid_argument("Malformed topology cache line '" + line +
+                                  "'");
+    if ("cpus" == key)
+      match = CPUSet(list) == cpus();
+    else if ("cluster" == key)
+      clusters.emplace_back(list);
+  }
+  if (!match || clusters.empty())
+    return false;
+
+  std::vector<CPU> old = mCPUs;
+  CPUSet           clustered;
+  for (CPUSet const& cluster : clusters) {
+    for (int cpu = cluster.first(), last = cluster.last(); cpu <= last;
+         ++cpu) {
+      if (online(cpu) && cluster.is_set(cpu)) {
+        mCPUs[cpu].mLLC = cluster.first();
+        clustered.set(cpu);
+      }
+    }
+  }
+
+  // CPUs that were not measured keep their last level caches, identified by
+  // their lowest numbered CPU that was not measured either, so that they
+  // don't join a cluster.
+  for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+    if (!online(cpu) || clustered.is_set(cpu))
+      continue;
+    for (int n = 0; n <= cpu; ++n) {
+      if (online(n) && !clustered.is_set(n) &&
+          (old[n].mLLC == old[cpu].mLLC)) {
+        mCPUs[cpu].mLLC = n;
+        break;
+      }
+    }
+  }
+  sort();
+  return true;
+}
+
+CPUSet CPUTopology::cpus() const
+{
+  CPUSet result;
+  for (int cpu = 0; cpu < (int)mCPUs.size(); ++cpu) {
+    if (online(cpu))
+      result.set(cpu);
+  }
+  return result;
+}
+
+CPUSet CPUTopology::core(int cpu) const
+{
+  CPUSet result;
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && (mCPUs[n].mCore == mCPUs[cpu].mCore))
+      result.set(n);
+  }
+  return result;
+}
+
+CPUSet CPUTopology::llc(int cpu) const
+{
+  CPUSet result;
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && (mCPUs[n].mLLC == mCPUs[cpu].mLLC))
+      result.set(n);
+  }
+  return result;
+}
+
+CPUSet CPUTopology::node(int node) const
+{
+  CPUSet result;
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && (mCPUs[n].mNode == node))
+      result.set(n);
+  }
+  return result;
+}
+
+CPUSet CPUTopology::nodes(CPUSet const& set) const
+{
+  CPUSet result;
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && set.is_set(n))
+      result.set(mCPUs[n].mNode);
+  }
+  return result;
+}
+
+std::vector<CPUSet> CPUTopology::cores(CPUSet const& set) const
+{
+  // Collect the (LLC, core) pairs of the CPUs in set, then build one CPUSet
+  // per distinct core.
+  std::vector<std::pair<int, int>> ids;
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && set.is_set(n))
+      ids.emplace_back(mCPUs[n].mLLC, mCPUs[n].mCore);
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  std::vector<CPUSet> result;
+  for (auto const& id : ids)
+    result.push_back(core(id.second) & set);
+  return result;
+}
+
+std::string CPUTopology::to_string(CPUSet const& set) const
+{
+  std::string result = "# cpu core llc node\n";
+  for (int n = 0; n < (int)mCPUs.size(); ++n) {
+    if (online(n) && set.is_set(n)) {
+      result += std::to_string(n) + ' ' + std::to_string(mCPUs[n].mCore) +
+                ' ' + std::to_string(mCPUs[n].mLLC) + ' ' +
+                std::to_string(mCPUs[n].mNode) + '\n';
+    }
+  }
+  return result;
+}
@@ -0,0 +1,140 @@
+// CPUTopology.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef CPUTopology_hpp
+#define CPUTopology_hpp
+
+#include "CPUSet.hpp"
+
+#include <string>
+#include <vector>
+
+//! Path to cpu root
+#define CPU_ROOT "/sys/devices/system/cpu"
+
+//! Path to NUMA node root
+#define NODE_ROOT "/sys/devices/system/node"
+
+//! Path to the topology cache written by runexcl --measure-topology
+#define TOPOLOGY_CACHE "/var/cache/runexcl/topology"
+
+//! Description of how the CPUs of the system are grouped into physical cores,
+//! last level caches, and NUMA nodes.
+class CPUTopology
+{
+public:
+  //! Placement of a single CPU. Cores and last level caches are identified by
+  //! the lowest numbered CPU they contain. All IDs are -1 for CPUs that are
+  //! not online.
+  struct CPU
+  {
+    int mCore = -1;
+    int mLLC  = -1;
+    int mNode = -1;
+  };
+
+protected:
+  //! Placement of each CPU, indexed by CPU number.
+  std::vector<CPU> mCPUs;
+  //! Online CPUs ordered by NUMA node, last level cache, core, and number.
+  std::vector<int> mOrder;
+  //! CPUs isolated from the scheduler at boot (isolcpus=).
+  CPUSet mIsolated;
+  //! CPUs running without the scheduler tick when possible (nohz_full=).
+  CPUSet mNohzFull;
+
+  //! Set up mOrder from mCPUs.
+  void sort();
+
+public:
+  //! Read the topology of the online CPUs from sysfs, and apply the
+  //! clusters of the topology cache if it matches the online CPUs.
+  CPUTopology();
+
+  //! Create a synthetic topology, numbering the CPUs the way Linux does on
+  //! x86, i.e. the first hardware thread of all cores comes first.
+  CPUTopology(int nodes, int llcs_per_node, int cores_per_llc,
+              int threads_per_core);
+
+  bool online(int cpu) const
+  {
+    return (cpu >= 0) && (cpu < (int)mCPUs.size()) && (-1 != mCPUs[cpu].mCore);
+  }
+
+  CPU const& operator[](int cpu) const
+  {
+    return mCPUs[cpu];
+  }
+
+  //! Return the online CPUs ordered by NUMA node, last level cache, and core,
+  //! i.e. CPUs that are close to each other are next to each other.
+  std::vector<int> const& order() const
+  {
+    return mOrder;
+  }
+
+  //! Apply the clusters of a topology cache (see CoreLatency::save) in text,
+  //! i.e. group the CPUs by measured latency instead of by last level cache.
+  //! Returns false, leaving the topology unchanged, if text describes other
+  //! online CPUs.
+  //! \throw std::invalid_argument if text is malformed.
+  bool load_clusters(std::string const& text);
+
+  //! Return the set of all online CPUs.
+  CPUSet cpus() const;
+
+  //! Return the CPUs the kernel was told to keep quiet at boot, i.e. the
+  //! CPUs given to isolcpus= or nohz_full=.
+  CPUSet boot_isolated() const
+  {
+    CPUSet result(mIsolated);
+    result |= mNohzFull;
+    return result;
+  }
+
+  //! Return the CPUs given to nohz_full=.
+  CPUSet const& nohz_full() const
+  {
+    return mNohzFull;
+  }
+  //! Return the CPUs sharing the physical core with cpu.
+  CPUSet core(int cpu) const;
+  //! Return the CPUs sharing the last level cache with cpu.
+  CPUSet llc(int cpu) const;
+  //! Return the CPUs of NUMA node node.
+  CPUSet node(int node) const;
+
+  //! Return the NUMA nodes the CPUs in set belong to. Since a node list has
+  //! the same format as a CPU list, the result is returned as a CPUSet.
+  CPUSet nodes(CPUSet const& set) const;
+
+  //! Split set into physical cores, ordered by last level cache and core.
+  std::vector<CPUSet> cores(CPUSet const& set) const;
+
+  //! Return a machine-readable description of the topology of the CPUs in
+  //! set, consisting of one line per CPU with the CPU number, core ID, LLC ID,
+  //! and NUMA node.
+  std::string to_string(CPUSet const& set) const;
+};
+
+#endif // CPUTopology_hpp
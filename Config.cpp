@@ -0,0 +1,261 @@
+// Config.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Config.hpp"
+#include "CPUCGroup.hpp"
+#include "parse.hpp"
+#include "sysfs.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+// Remove leading and trailing whitespace from str.
+static std::string trim(std::string const& str)
+{
+  auto first = str.find_first_not_of(" \t\r");
+  if (std::string::npos == first)
+    return std::string();
+  auto last = str.find_last_not_of(" \t\r");
+  return str.substr(first, last - first + 1);
+}
+
+// Parse a comma separated list of '<class>:<scope>' anti-affinity rules into
+// rules, where scope is llc, node, or none to drop the rule for the class.
+static void parse_anti_affinity(std::string const&                  str,
+                                std::map<std::string, std::string>& rules)
+{
+  char const*        classes[] = {JOB_CLASSES};
+  std::istringstream in(str);
+  for (std::string rule; std::getline(in, rule, ',');) {
+    rule              = trim(rule);
+    auto        colon = rule.find(':');
+    std::string cls   = trim(rule.substr(0, colon));
+    std::string scope;
+    if (std::string::npos != colon)
+      scope = trim(rule.substr(colon + 1));
+    if ((std::find(std::begin(classes), std::end(classes), cls) ==
+         std::end(classes)) ||
+        (("llc" != scope) && ("node" != scope) && ("none" != scope)))
+      throw std::invalid_argument("invalid anti-affinity rule '" + rule +
+                                  "'");
+    if ("none" == scope)
+      rules.erase(cls);
+    else
+      rules[cls] = scope;
+  }
+}
+
+NoiseProfile::NoiseProfile(std::string const& str)
+{
+  std::istringstream in(str);
+  if (!(in >> mWatchdog >> mStatInterval >> mRTRuntime >> mTimerMigration))
+    throw std::invalid_argument("Invalid noise profile '" + str + "'");
+}
+
+NoiseProfile& NoiseProfile::operator|=(NoiseProfile const& other)
+{
+  mWatchdog |= other.mWatchdog;
+  mStatInterval = std::max(mStatInterval, other.mStatInterval);
+
+  // No RT throttling is the quietest, otherwise the longest runtime.
+  if ((-1 == mRTRuntime) || (-1 == other.mRTRuntime))
+    mRTRuntime = -1;
+  else
+    mRTRuntime = std::max(mRTRuntime, other.mRTRuntime);
+
+  // Not migrating timers keeps them off the isolated CPUs.
+  if (NOISE_UNSET == mTimerMigration)
+    mTimerMigration = other.mTimerMigration;
+  else if (NOISE_UNSET != other.mTimerMigration)
+    mTimerMigration = std::min(mTimerMigration, other.mTimerMigration);
+  return *this;
+}
+
+std::string NoiseProfile::to_string() const
+{
+  return std::to_string(mWatchdog) + ' ' + std::to_string(mStatInterval) +
+         ' ' + std::to_string(mRTRuntime) + ' ' +
+         std::to_string(mTimerMigration);
+}
+
+std::string Pool::slice() const
+{
+  if (mName.empty())
+    return RUNEXCL_SLICE;
+  return CGROUP_ROOT "/runexcl." + mName + ".slice";
+}
+
+void Config::read(char const* path)
+{
+  struct stat st;
+  if (::stat(path, &st)) {
+    if (ENOENT == errno)
+      return;
+    throw std::system_error(errno, std::system_category(),
+                            "stat(\"" + std::string(path) + "\")");
+  }
+
+  // runexcl runs SUID root, so the configuration must not be under the
+  // control of anybody but root.
+  if (st.st_uid || (st.st_mode & (S_IWGRP | S_IWOTH)))
+    throw std::runtime_error("'" + std::string(path) +
+                             "' must be owned and only writable by root");
+
+  std::istringstream in(read_file(path));
+  parse(in, path);
+}
+
+void Config::parse(std::istream& in, std::string const& name)
+{
+  std::string line;
+  int         lineno = 0;
+  auto        error  = [&](std::string const& what) {
+    return std::runtime_error(name + ":" + std::to_string(lineno) + ": " +
+                              what);
+  };
+
+  while (std::getline(in, line)) {
+    lineno += 1;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+
+    if ('[' == line[0]) {
+      if (']' != line.back())
+        throw error("missing ']'");
+      std::istringstream header(line.substr(1, line.size() - 2));
+      Section            section;
+      if (!(header >> section.mType >> section.mName))
+        throw error("section header must be '[<type> <name>]'");
+      mSections.push_back(section);
+    }
+    else {
+      auto pos = line.find('=');
+      if ((std::string::npos == pos) || mSections.empty())
+        throw error("expected '<key> = <value>' inside a section");
+      mSections.back().mValues[trim(line.substr(0, pos))] =
+          trim(line.substr(pos + 1));
+    }
+  }
+
+  // Sibling slices cannot share exclusive CPUs, so partitions in pools with
+  // overlapping CPUs would fail depending on which pool took a CPU first.
+  CPUSet claimed;
+  for (Section const& section : mSections) {
+    auto cpus = section.mValues.find("cpus");
+    if (("pool" != section.mType) || (section.mValues.end() == cpus))
+      continue;
+    CPUSet set;
+    try {
+      set.parse(cpus->second);
+    }
+    catch (std::invalid_argument const& e) {
+      throw std::runtime_error(name + ": pool '" + section.mName +
+                               "': " + e.what());
+    }
+    if (!(claimed & set).empty())
+      throw std::runtime_error(name + ": pool '" + section.mName +
+                               "' shares CPUs '" +
+                               (claimed & set).to_string() +
+                               "' with another pool");
+    claimed |= set;
+  }
+}
+
+Config::Section const* Config::section(std::string const& type,
+                                       std::string const& name) const
+{
+  for (Section const& section : mSections) {
+    if ((section.mType == type) && (section.mName == name))
+      return &section;
+  }
+  return nullptr;
+}
+
+Pool Config::pool(std::string const& name) const
+{
+  // The pool name becomes part of a path below CGROUP_ROOT.
+  if (std::string::npos != name.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+                                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                                  "0123456789_-"))
+    throw std::runtime_error("Invalid pool name '" + name + "'");
+
+  Pool           pool;
+  Section const* config = section("pool", name.empty() ? "default" : name);
+  if (!config && !name.empty())
+    throw std::runtime_error("Unknown pool '" + name + "'");
+
+  // Pools without their own CPUs share the CPUs no other pool reserved.
+  for (Section const& other : mSections) {
+    auto cpus = other.mValues.find("cpus");
+    if (("pool" == other.mType) && (&other != config) &&
+        (other.mValues.end() != cpus))
+      pool.mClaimed |= CPUSet(cpus->second);
+  }
+  if (!config)
+    return pool;
+
+  pool.mName = ("default" == name) ? std::string() : name;
+  for (auto const& value : config->mValues) {
+    try {
+      if ("cpus" == value.first)
+        pool.mCPUs.parse(value.second);
+      else if ("anti-affinity" == value.first)
+        parse_anti_affinity(value.second, pool.mAntiAffinity);
+      else if ("frequency" == value.first)
+        pool.mFrequency = parse_frequency(value.second);
+      else if ("frequency-grace" == value.first)
+        pool.mFrequencyGrace = parse_duration(value.second);
+      else if ("isolate" == value.first)
+        pool.mIsolate = parse_bool(value.second);
+      else if ("policy" == value.first)
+        pool.mPolicy = CPUAllocator::policy(value.second);
+      else if ("quiet-watchdog" == value.first)
+        pool.mNoise.mWatchdog = parse_bool(value.second);
+      else if ("vmstat-interval" == value.first)
+        pool.mNoise.mStatInterval = parse_long(value.second, 0, 86400);
+      else if ("rt-runtime" == value.first)
+        pool.mNoise.mRTRuntime = parse_long(value.second, -1, INT_MAX);
+      else if ("timer-migration" == value.first)
+        pool.mNoise.mTimerMigration = parse_bool(value.second);
+      else
+        throw std::invalid_argument("unknown key '" + value.first + "'");
+    }
+    catch (std::exception const& e) {
+      throw std::runtime_error("pool '" + config->mName + "': " + e.what());
+    }
+  }
+
+  if (!pool.mCPUs.empty())
+    pool.mClaimed = CPUSet();
+  return pool;
+}
@@ -0,0 +1,168 @@
+// Config.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Config_hpp
+#define Config_hpp
+
+#include "CPUAllocator.hpp"
+#include "CPUSet.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+//! Path to the configuration file. Since runexcl runs SUID root, the file
+//! must be owned by root and must not be writable by anybody else.
+#define RUNEXCL_CONFIG "/etc/runexcl.conf"
+
+//! Directory for state that must outlive a runexcl process, but not a
+//! reboot.
+#define RUNEXCL_STATE "/run/runexcl"
+
+//! Value of NoiseProfile members that leave their tunable alone.
+#define NOISE_UNSET -2
+
+//! Settings of global kernel tunables that reduce the periodic kernel
+//! activity on the CPUs of isolated partitions. Since the tunables are shared
+//! by all partitions, CPUCGroup combines the profiles of all isolated
+//! partitions, and restores the original settings when the last one is gone.
+struct NoiseProfile
+{
+  //! Remove the CPUs from kernel/watchdog_cpumask.
+  bool mWatchdog = false;
+  //! Minimum for vm/stat_interval in seconds, 0 to leave it alone.
+  int mStatInterval = 0;
+  //! Value for kernel/sched_rt_runtime_us, -1 to disable RT throttling.
+  long mRTRuntime = NOISE_UNSET;
+  //! Value for kernel/timer_migration.
+  int mTimerMigration = NOISE_UNSET;
+
+  NoiseProfile() = default;
+
+  //! Parse a profile returned by to_string().
+  //! \throw std::invalid_argument if str is malformed.
+  explicit NoiseProfile(std::string const& str);
+
+  bool empty() const
+  {
+    return !mWatchdog && !mStatInterval && (NOISE_UNSET == mRTRuntime) &&
+           (NOISE_UNSET == mTimerMigration);
+  }
+
+  //! Combine with other, using the quieter setting of each tunable.
+  NoiseProfile& operator|=(NoiseProfile const& other);
+
+  std::string to_string() const;
+};
+
+//! Job classes a partition can be labeled with (see Pool::mAntiAffinity).
+#define JOB_CLASSES "membw", "cache", "compute"
+
+//! A pool of CPUs managed by its own slice.
+struct Pool
+{
+  //! Name of the pool, empty for the default pool.
+  std::string mName;
+  //! CPUs reserved for the pool. If empty, the pool uses the CPUs available
+  //! to the root cgroup that are not in mClaimed.
+  CPUSet mCPUs;
+  //! CPUs reserved by the pools with their own CPUs. Only set for pools
+  //! without their own CPUs, which share the rest.
+  CPUSet mClaimed;
+  //! Default frequency for partitions (see parse_frequency), 0.0 to leave the
+  //! frequency alone.
+  double mFrequency = 0.0;
+  //! Seconds the frequency settings of a partition's CPUs are kept after it
+  //! ends, so that a following partition asking for the same settings
+  //! doesn't have to wait for them to be changed back and forth.
+  double mFrequencyGrace = 0.0;
+  //! Whether partitions are isolated by default.
+  bool mIsolate = false;
+  //! Policy for selecting CPUs automatically.
+  AllocationPolicy mPolicy = AllocationPolicy::Compact;
+  //! Kernel tunables to adjust while partitions are isolated.
+  NoiseProfile mNoise;
+  //! Scope ("llc" or "node") within which no two partitions of a job class
+  //! may run, by class. Partitions of classes without an entry may share
+  //! everything but their CPUs.
+  std::map<std::string, std::string> mAntiAffinity = {{"membw", "node"},
+                                                      {"cache", "llc"}};
+
+  //! Return the path of the pool's slice, i.e. runexcl.slice for the default
+  //! pool and runexcl.<name>.slice otherwise.
+  std::string slice() const;
+};
+
+//! runexcl configuration. The configuration file consists of sections that
+//! start with a '[<type> <name>]' header, followed by '<key> = <value>' lines.
+//! Everything following a '#' is a comment. For example:
+//!
+//!   [pool lowlat]
+//!   cpus      = 2-7
+//!   frequency = max
+//!   isolate   = yes
+//!   policy    = compact
+//!   quiet-watchdog  = yes
+//!   vmstat-interval = 10
+//!   anti-affinity   = membw:node, cache:llc
+//!
+//!   [group students]
+//!   max-cpus     = 4
+//!   max-isolated = 0
+//!   frequency    = min, nonlinear
+class Config
+{
+public:
+  struct Section
+  {
+    std::string                        mType;
+    std::string                        mName;
+    std::map<std::string, std::string> mValues;
+  };
+
+protected:
+  std::vector<Section> mSections;
+
+public:
+  //! Read the configuration from path. A missing file is not an error.
+  //! \throw std::runtime_error if the file is not owned by root or has
+  //! syntax errors.
+  void read(char const* path = RUNEXCL_CONFIG);
+
+  //! Add the sections read from in. name is used in error messages.
+  //! \throw std::runtime_error if in has syntax errors, or pools now share
+  //! CPUs.
+  void parse(std::istream& in, std::string const& name);
+
+  //! Return the section with the given type and name, or nullptr.
+  Section const* section(std::string const& type,
+                         std::string const& name) const;
+
+  //! Return the pool called name. The default pool (empty name) always
+  //! exists, but can be configured with a '[pool default]' section.
+  //! \throw std::runtime_error if there is no such pool.
+  Pool pool(std::string const& name) const;
+};
+
+#endif // Config_hpp
@@ -0,0 +1,192 @@
+// CoreLatency.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "CoreLatency.hpp"
+#include "CPUClock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+double CoreLatency::ping_pong(int a, int b, int round_trips)
+{
+  // Keep the flag in a cache line of its own, so that nothing else causes
+  // traffic on it.
+  struct alignas(64) Line
+  {
+    std::atomic<int> mValue{0};
+  } line;
+
+  // The thread on b answers each odd value with the next even one.
+  std::thread pong([&]() {
+    CPUSet pin;
+    pin.set(b);
+    pin.setaffinity();
+    for (int i = 0; i < round_trips; ++i) {
+      int expected = 2 * i + 1;
+      while (line.mValue.load(std::memory_order_acquire) != expected)
+        ;
+      line.mValue.store(expected + 1, std::memory_order_release);
+    }
+  });
+
+  CPUSet pin;
+  pin.set(a);
+  pin.setaffinity();
+  double start = 0.0;
+  for (int i = 0; i < round_trips; ++i) {
+    // Don't count the first round trip, which includes the thread start.
+    if (1 == i)
+      start = CPUClock::now();
+    line.mValue.store(2 * i + 1, std::memory_order_release);
+    while (line.mValue.load(std::memory_order_acquire) != 2 * i + 2)
+      ;
+  }
+  double elapsed = CPUClock::now() - start;
+  pong.join();
+  return elapsed / (round_trips - 1) / 2;
+}
+
+void CoreLatency::measure(CPUSet const& set, CPUTopology const& topology)
+{
+  mCPUs.clear();
+  for (CPUSet const& core : topology.cores(set))
+    mCPUs.push_back(core.first());
+  std::sort(mCPUs.begin(), mCPUs.end());
+
+  size_t n = mCPUs.size();
+  mLatency.assign(n * n, 0.0);
+  for (size_t a = 0; a < n; ++a) {
+    for (size_t b = a + 1; b < n; ++b) {
+      double value = ping_pong(mCPUs[a], mCPUs[b], 10000);
+      mLatency[a * n + b] = mLatency[b * n + a] = value;
+    }
+  }
+}
+
+std::vector<CPUSet> CoreLatency::clusters(CPUTopology const& topology) const
+{
+  // The typical latency between close cores is the median of the latencies
+  // of each core to its nearest neighbour.
+  size_t              n = mCPUs.size();
+  std::vector<double> nearest;
+  for (size_t a = 0; a < n; ++a) {
+    double best = -1.0;
+    for (size_t b = 0; b < n; ++b) {
+      if ((a != b) && ((best < 0.0) || (latency(a, b) < best)))
+        best = latency(a, b);
+    }
+    if (best >= 0.0)
+      nearest.push_back(best);
+  }
+  std::sort(nearest.begin(), nearest.end());
+  double limit =
+      nearest.empty() ? 0.0 : CLUSTER_TOLERANCE * nearest[nearest.size() / 2];
+
+  // Add each core to the first cluster all of whose cores are within the
+  // limit, going through the cores in topology order so that the result
+  // doesn't depend on the CPU numbering.
+  std::vector<std::vector<size_t>> members;
+  for (int cpu : topology.order()) {
+    auto it = std::find(mCPUs.begin(), mCPUs.end(), cpu);
+    if (it == mCPUs.end())
+      continue;
+    size_t a     = it - mCPUs.begin();
+    auto   close = [&](std::vector<size_t> const& cluster) {
+      for (size_t b : cluster) {
+        if (latency(a, b) > limit)
+          return false;
+      }
+      return true;
+    };
+    auto cluster = std::find_if(members.begin(), members.end(), close);
+    if (cluster == members.end())
+      members.emplace_back(1, a);
+    else
+      cluster->push_back(a);
+  }
+
+  std::vector<CPUSet> result;
+  for (auto const& cluster : members) {
+    result.emplace_back();
+    for (size_t a : cluster)
+      result.back() |= topology.core(mCPUs[a]);
+  }
+  return result;
+}
+
+std::string CoreLatency::to_string() const
+{
+  std::ostringstream out;
+  out << "Core-to-core latency (ns):\n     ";
+  for (int cpu : mCPUs)
+    out << std::setw(6) << cpu;
+  out << '\n';
+  for (size_t a = 0; a < mCPUs.size(); ++a) {
+    out << std::setw(5) << mCPUs[a];
+    for (size_t b = 0; b < mCPUs.size(); ++b) {
+      if (a == b)
+        out << std::setw(6) << '-';
+      else
+        out << std::setw(6) << std::fixed << std::setprecision(0)
+            << latency(a, b) * 1e9;
+    }
+    out << '\n';
+  }
+  return out.str();
+}
+
+void CoreLatency::save(std::string const& path,
+                       CPUTopology const& topology) const
+{
+  std::error_code error;
+  fs::create_directories(fs::path(path).parent_path(), error);
+
+  // Write to a temporary file and rename it, so that runexcl never reads a
+  // partial cache.
+  std::string   temp = path + ".tmp";
+  std::ofstream out(temp);
+  out << "# runexcl topology cache\n"
+      << "cpus " << topology.cpus().to_string() << '\n';
+  for (CPUSet const& cluster : clusters(topology))
+    out << "cluster " << cluster.to_string() << '\n';
+  for (size_t a = 0; a < mCPUs.size(); ++a) {
+    for (size_t b = a + 1; b < mCPUs.size(); ++b)
+      out << "latency " << mCPUs[a] << ' ' << mCPUs[b] << ' '
+          << latency(a, b) * 1e9 << '\n';
+  }
+  out.close();
+  if (!out || ::rename(temp.c_str(), path.c_str()))
+    throw std::system_error(out ? errno : EIO, std::system_category(),
+                            "Writing " + path);
+}
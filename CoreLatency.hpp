@@ -0,0 +1,82 @@
+// CoreLatency.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef CoreLatency_hpp
+#define CoreLatency_hpp
+
+#include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+
+#include <string>
+#include <vector>
+
+//! Cores whose latency to all other cores of a cluster is at most this factor
+//! times the typical latency to the nearest core join the cluster.
+#define CLUSTER_TOLERANCE 1.5
+
+//! Matrix of the cache-to-cache latencies between physical cores, measured by
+//! bouncing a cache line between threads pinned to the cores. Each core is
+//! represented by its lowest numbered CPU, as SMT siblings share their
+//! caches anyway.
+class CoreLatency
+{
+protected:
+  std::vector<int>    mCPUs;
+  std::vector<double> mLatency; // One-way latencies in seconds, row-major.
+
+public:
+  CoreLatency() = default;
+  //! Use a given matrix, e.g. for testing.
+  CoreLatency(std::vector<int> cpus, std::vector<double> latency)
+    : mCPUs(std::move(cpus)), mLatency(std::move(latency))
+  {
+  }
+
+  //! Return the one-way latency in seconds of handing a cache line from the
+  //! thread pinned to cpu a to the thread pinned to cpu b and back,
+  //! averaged over round_trips round trips.
+  static double ping_pong(int a, int b, int round_trips);
+
+  //! Measure the latency between every pair of cores of set.
+  void measure(CPUSet const& set, CPUTopology const& topology);
+
+  double latency(size_t a, size_t b) const
+  {
+    return mLatency[a * mCPUs.size() + b];
+  }
+
+  //! Group the cores into clusters in which all cores have a low latency to
+  //! each other, and return the CPUs of each cluster, including the SMT
+  //! siblings.
+  std::vector<CPUSet> clusters(CPUTopology const& topology) const;
+
+  //! Return the matrix in nanoseconds as a human readable table.
+  std::string to_string() const;
+
+  //! Write the online CPUs of topology, the clusters, and the matrix to the
+  //! topology cache at path (see CPUTopology::load_clusters).
+  //! \throw std::system_error if the file cannot be written.
+  void save(std::string const& path, CPUTopology const& topology) const;
+};
+
+#endif // CoreLatency_hpp
@@ -0,0 +1,198 @@
+// Filler.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Filler.hpp"
+#include "CPUClock.hpp"
+#include "sysfs.hpp"
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+Filler::Filler(std::string const& partition, int cpus, double guard)
+  : mOwner(partition), mPath(partition + "/filler"), mCPUs(cpus),
+    mGuard(guard)
+{
+  if (::mkdir(mPath.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH))
+    throw std::system_error(errno, std::system_category(),
+                            "mkdir(" + mPath + ")");
+}
+
+Filler::~Filler()
+{
+  try {
+    stop();
+  }
+  catch (std::exception const&) {
+  }
+  ::rmdir(mPath.c_str());
+}
+
+void Filler::enter()
+{
+  sysfs_write(mPath + "/cgroup.procs", std::to_string(::getpid()));
+
+  struct sched_param param = {0};
+  if (::sched_setscheduler(0, SCHED_IDLE, &param))
+    throw std::system_error(errno, std::system_category(),
+                            "sched_setscheduler(SCHED_IDLE)");
+}
+
+void Filler::watch(pid_t pid)
+{
+  mPID    = pid;
+  mThread = std::thread(&Filler::run, this);
+}
+
+void Filler::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStop)
+      return;
+    mStop = true;
+  }
+  mWakeup.notify_all();
+  if (mThread.joinable())
+    mThread.join();
+
+  // cgroup.kill kills frozen processes as well. Older kernels don't have it,
+  // so kill the processes one by one there; SIGKILL gets through the freezer,
+  // too.
+  try {
+    sysfs_write(mPath + "/cgroup.kill", "1");
+  }
+  catch (std::exception const&) {
+    std::ifstream procs(mPath + "/cgroup.procs");
+    for (pid_t pid; procs >> pid;)
+      ::kill(pid, SIGKILL);
+  }
+
+  // The filler may have started processes of its own, which are gone once
+  // the cgroup is empty.
+  if (mPID)
+    ::waitpid(mPID, nullptr, 0);
+  for (int i = 0; i < 100; ++i) {
+    std::ifstream events(mPath + "/cgroup.events");
+    std::string   key;
+    int           value = 0;
+    while ((events >> key >> value) && ("populated" != key))
+      ;
+    if (!value)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+void Filler::freeze(bool frozen)
+{
+  sysfs_write(mPath + "/cgroup.freeze", frozen ? "1" : "0");
+  mFrozen = frozen;
+}
+
+std::map<pid_t, Filler::Task> Filler::tasks(std::string const& path)
+{
+  // /proc/<tid>/schedstat contains the time the thread ran, the time it
+  // waited on a run queue (both in ns), and the number of timeslices it ran.
+  std::map<pid_t, Task> result;
+  std::ifstream         threads(path + "/cgroup.threads");
+  for (pid_t tid; threads >> tid;) {
+    std::ifstream schedstat("/proc/" + std::to_string(tid) + "/schedstat");
+    double        runtime;
+    Task          task;
+    if (schedstat >> runtime >> task.mRunDelay >> task.mTimeslices)
+      result[tid] = task;
+  }
+  return result;
+}
+
+void Filler::run()
+{
+  double                last   = CPUClock::now();
+  double                frozen = 0.0; // When the filler was frozen.
+  std::map<pid_t, Task> before = tasks(mOwner);
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (!mWakeup.wait_for(lock, std::chrono::milliseconds(250),
+                           [this] { return mStop; })) {
+    double                now   = CPUClock::now();
+    std::map<pid_t, Task> after = tasks(mOwner);
+
+    // Only threads seen both times count, as threads come and go.
+    Task delta;
+    for (auto const& task : after) {
+      auto it = before.find(task.first);
+      if (it == before.end())
+        continue;
+      delta.mRunDelay += task.second.mRunDelay - it->second.mRunDelay;
+      delta.mTimeslices += task.second.mTimeslices - it->second.mTimeslices;
+    }
+    mLatency[mFrozen].mRunDelay += delta.mRunDelay;
+    mLatency[mFrozen].mTimeslices += delta.mTimeslices;
+    mTime[mFrozen] += now - last;
+
+    // The percentage of time the owner's threads waited for a CPU, per CPU.
+    double waiting = delta.mRunDelay / 1e7 / (now - last) / mCPUs;
+    try {
+      if (!mFrozen && (waiting > mGuard)) {
+        freeze(true);
+        frozen = now;
+      }
+      else if (mFrozen && (now - frozen >= FILLER_THAW_DELAY))
+        freeze(false);
+    }
+    catch (std::exception const&) {
+      // The kernel doesn't support freezing, so just let the filler run.
+    }
+
+    before = std::move(after);
+    last   = now;
+  }
+}
+
+std::string Filler::report() const
+{
+  char        buffer[160];
+  char const* when[] = {"with", "without"};
+  double      total  = mTime[0] + mTime[1];
+  int         n      = std::snprintf(
+      buffer, sizeof(buffer), "frozen %.0f%% of the time",
+      total > 0.0 ? 100.0 * mTime[1] / total : 0.0);
+  for (int i = 0; i < 2; ++i) {
+    if (mLatency[i].mTimeslices > 0.0)
+      n += std::snprintf(buffer + n, sizeof(buffer) - n,
+                         ", owner wakeup latency %.1f us %s filler",
+                         mLatency[i].mRunDelay / 1e3 / mLatency[i].mTimeslices,
+                         when[i]);
+  }
+  return buffer;
+}
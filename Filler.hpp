@@ -0,0 +1,99 @@
+// Filler.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Filler_hpp
+#define Filler_hpp
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//! How long the filler stays frozen before it is given another chance.
+#define FILLER_THAW_DELAY 2.0
+
+//! Run low priority filler work on the idle CPU time of a partition. The
+//! filler runs with the SCHED_IDLE policy in the partition's filler cgroup, so
+//! it only gets the CPUs when the partition's own threads don't need them. A
+//! guard thread watches how long the partition's own threads wait for a CPU,
+//! and freezes the filler while that exceeds a limit.
+class Filler
+{
+protected:
+  //! Time spent waiting on a run queue in ns, and number of timeslices run.
+  struct Task
+  {
+    double mRunDelay   = 0.0;
+    double mTimeslices = 0.0;
+  };
+
+  std::string             mOwner;
+  std::string             mPath;
+  int                     mCPUs;
+  double                  mGuard;
+  std::thread             mThread;
+  std::mutex              mMutex;
+  std::condition_variable mWakeup;
+  pid_t                   mPID    = 0;
+  bool                    mStop   = false;
+  bool                    mFrozen = false;
+  // The owner's waits, and the time spent, while the filler was running
+  // (index 0) or frozen (index 1).
+  Task                    mLatency[2];
+  double                  mTime[2] = {0.0, 0.0};
+
+  void run();
+  void freeze(bool frozen);
+
+  //! Return the run queue wait and timeslices of the threads of the cgroup
+  //! at path.
+  static std::map<pid_t, Task> tasks(std::string const& path);
+
+public:
+  //! Create the filler cgroup of the partition at partition with cpus CPUs.
+  //! The filler is frozen while the partition's threads wait for a CPU more
+  //! than guard percent of the time.
+  Filler(std::string const& partition, int cpus, double guard);
+  //! Stop the filler, and remove its cgroup.
+  ~Filler();
+
+  //! Move the calling process into the filler cgroup, and switch it to the
+  //! SCHED_IDLE policy.
+  void enter();
+
+  //! Start guarding the partition's threads against the filler process pid,
+  //! which must be a child of the calling process.
+  void watch(pid_t pid);
+
+  //! Stop guarding, kill the filler, and reap it.
+  void stop();
+
+  //! Return a description of the time the filler was frozen and of the
+  //! owner's wakeup latency with and without it. Must be called after stop.
+  std::string report() const;
+};
+
+#endif // Filler_hpp
@@ -0,0 +1,219 @@
+// LoadMonitor.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "LoadMonitor.hpp"
+#include "CPUClock.hpp"
+#include "print.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// Read the entire file at path. Returns an empty string if the file cannot be
+// read.
+static std::string read_file(std::string const& path)
+{
+  std::ifstream      in(path);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+LoadMonitor::LoadMonitor(std::string const& path, CPUSet const& cpus,
+                         double sustain)
+  : mPath(path), mCPUs(cpus), mSustain(sustain)
+{
+  mThread = std::thread(&LoadMonitor::run, this);
+}
+
+LoadMonitor::~LoadMonitor()
+{
+  stop();
+}
+
+void LoadMonitor::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWakeup.notify_all();
+  if (mThread.joinable())
+    mThread.join();
+}
+
+void LoadMonitor::run()
+{
+  int cpus = mCPUs.count();
+  try {
+    Sample last   = sample(mPath, mCPUs);
+    double since  = -1.0; // Start of the current oversubscribed run.
+    bool   warned = false;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mWakeup.wait_for(lock, std::chrono::seconds(1),
+                             [this] { return mStop; })) {
+      Sample now  = sample(mPath, mCPUs);
+      Load   load = LoadMonitor::load(last, now, cpus);
+      if (!load.oversubscribed(cpus)) {
+        since = -1.0;
+        last  = now;
+        continue;
+      }
+
+      mOversubscribed += now.mTime - last.mTime;
+      mWorst.mThreads  = std::max(mWorst.mThreads, load.mThreads);
+      mWorst.mWaiting  = std::max(mWorst.mWaiting, load.mWaiting);
+      mWorst.mSome     = std::max(mWorst.mSome, load.mSome);
+      mWorst.mFull     = std::max(mWorst.mFull, load.mFull);
+      mWorst.mPressure = load.mPressure;
+
+      // Only warn once per run of oversubscribed intervals.
+      if (since < 0.0) {
+        since  = last.mTime;
+        warned = false;
+      }
+      if (!warned && (now.mTime - since >= mSustain)) {
+        print(2, "Warning: partition oversubscribed for %.0f s: %s\n",
+              now.mTime - since, to_string(load, cpus).c_str());
+        mSustained = true;
+        warned     = true;
+      }
+      last = now;
+    }
+  }
+  catch (std::exception const&) {
+    // The cgroup went away, so there is nothing left to watch.
+  }
+}
+
+std::string LoadMonitor::report() const
+{
+  if (!mSustained)
+    return std::string();
+
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "oversubscribed for %.0f s, worst: ",
+                mOversubscribed);
+  return buffer + to_string(mWorst, mCPUs.count());
+}
+
+LoadMonitor::Sample LoadMonitor::sample(std::string const& path,
+                                        CPUSet const&      cpus)
+{
+  Sample result;
+  result.mTime = CPUClock::now();
+
+  std::string threads = read_file(path + "/cgroup.threads");
+  if (threads.empty())
+    throw std::runtime_error("Cannot read " + path + "/cgroup.threads");
+  result.mThreads = std::count(threads.begin(), threads.end(), '\n');
+
+  // PSI may be disabled, in which case there is no cpu.pressure file.
+  std::string pressure = read_file(path + "/cpu.pressure");
+  if (!pressure.empty()) {
+    result.mSome     = parse_pressure(pressure, "some");
+    result.mFull     = parse_pressure(pressure, "full");
+    result.mPressure = true;
+  }
+
+  result.mRunDelay = parse_run_delay(read_file("/proc/schedstat"), cpus);
+  return result;
+}
+
+Load LoadMonitor::load(Sample const& from, Sample const& to, int cpus)
+{
+  Load   result;
+  double elapsed  = to.mTime - from.mTime;
+  result.mThreads = to.mThreads;
+  if ((elapsed <= 0.0) || (cpus <= 0))
+    return result;
+
+  result.mWaiting = (to.mRunDelay - from.mRunDelay) / 1e9 / elapsed / cpus;
+  if (from.mPressure && to.mPressure) {
+    result.mSome     = (to.mSome - from.mSome) / 1e4 / elapsed;
+    result.mFull     = (to.mFull - from.mFull) / 1e4 / elapsed;
+    result.mPressure = true;
+  }
+  return result;
+}
+
+double LoadMonitor::parse_pressure(std::string const& text,
+                                   std::string const& kind)
+{
+  // Each line looks like
+  //   some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) {
+    if (line.compare(0, kind.size() + 1, kind + ' '))
+      continue;
+    auto pos = line.find(" total=");
+    if (std::string::npos == pos)
+      break;
+    return std::strtod(line.c_str() + pos + 7, nullptr);
+  }
+  throw std::invalid_argument("No '" + kind + "' line in pressure data");
+}
+
+double LoadMonitor::parse_run_delay(std::string const& text,
+                                    CPUSet const&      cpus)
+{
+  // The CPU lines look like
+  //   cpu<N> <yld_count> 0 <sched_count> <sched_goidle> <ttwu_count>
+  //          <ttwu_local> <rq_cpu_time> <run_delay> <pcount>
+  // where run_delay is the time in ns tasks spent waiting on the run queue.
+  double             result = 0.0;
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) {
+    if (line.compare(0, 3, "cpu"))
+      continue;
+    std::istringstream fields(line.substr(3));
+    int                cpu;
+    double             value = 0.0;
+    if (!(fields >> cpu) || !cpus.is_set(cpu))
+      continue;
+    for (int i = 0; i < 8; ++i)
+      fields >> value;
+    if (fields)
+      result += value;
+  }
+  return result;
+}
+
+std::string LoadMonitor::to_string(Load const& load, int cpus)
+{
+  char buffer[160];
+  int  n = std::snprintf(buffer, sizeof(buffer),
+                         "%d threads on %d CPUs, %.1f threads waiting per CPU",
+                         load.mThreads, cpus, load.mWaiting);
+  if (load.mPressure)
+    std::snprintf(buffer + n, sizeof(buffer) - n,
+                  ", CPU pressure some %.0f%%, full %.0f%%", load.mSome,
+                  load.mFull);
+  return buffer;
+}
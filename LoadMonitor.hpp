@@ -0,0 +1,125 @@
+// LoadMonitor.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef LoadMonitor_hpp
+#define LoadMonitor_hpp
+
+#include "CPUSet.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//! An interval is considered oversubscribed if the partition has more threads
+//! than CPUs, and on average at least this many threads wait for each CPU...
+#define OVERSUBSCRIBED_WAITING 1.0
+//! ...or some of its threads wait for a CPU at least this percentage of the
+//! time.
+#define OVERSUBSCRIBED_PRESSURE 50.0
+
+//! The load of a partition over an interval.
+struct Load
+{
+  int    mThreads  = 0;     //!< Threads in the partition at the end.
+  double mWaiting  = 0.0;   //!< Average number of threads waiting per CPU.
+  double mSome     = 0.0;   //!< Percentage of time some threads waited.
+  double mFull     = 0.0;   //!< Percentage of time all threads waited.
+  bool   mPressure = false; //!< Whether mSome and mFull are known.
+
+  bool oversubscribed(int cpus) const
+  {
+    return (mThreads > cpus) && ((mWaiting >= OVERSUBSCRIBED_WAITING) ||
+                                 (mSome >= OVERSUBSCRIBED_PRESSURE));
+  }
+};
+
+//! Watch a partition in a background thread for more runnable threads than it
+//! has CPUs, using the number of threads in the cgroup, its CPU pressure, and
+//! the time tasks spent waiting on the run queues of its CPUs.
+class LoadMonitor
+{
+public:
+  //! The cumulative counters Load is computed from.
+  struct Sample
+  {
+    double mTime     = 0.0; //!< Monotonic time in seconds.
+    int    mThreads  = 0;
+    double mSome     = 0.0; //!< cpu.pressure "some" total in microseconds.
+    double mFull     = 0.0; //!< cpu.pressure "full" total in microseconds.
+    bool   mPressure = false;
+    double mRunDelay = 0.0; //!< Run queue wait of the CPUs in nanoseconds.
+  };
+
+protected:
+  std::string             mPath;
+  CPUSet                  mCPUs;
+  double                  mSustain;
+  std::thread             mThread;
+  std::mutex              mMutex;
+  std::condition_variable mWakeup;
+  bool                    mStop = false;
+
+  // The worst load seen in oversubscribed intervals, their total length, and
+  // whether the oversubscription was sustained at some point.
+  Load   mWorst;
+  double mOversubscribed = 0.0;
+  bool   mSustained      = false;
+
+  void run();
+
+public:
+  //! Start watching the cgroup at path running on cpus. A warning is printed
+  //! when the partition has been oversubscribed for sustain seconds in a
+  //! row.
+  LoadMonitor(std::string const& path, CPUSet const& cpus, double sustain);
+  ~LoadMonitor();
+
+  //! Stop watching.
+  void stop();
+
+  //! Return a description of the oversubscription seen, or an empty string if
+  //! there was none. Must be called after stop.
+  std::string report() const;
+
+  //! Read the counters of the cgroup at path running on cpus.
+  static Sample sample(std::string const& path, CPUSet const& cpus);
+
+  //! Compute the load between two samples of a partition with cpus CPUs.
+  static Load load(Sample const& from, Sample const& to, int cpus);
+
+  //! Return the total stall time in microseconds of the line starting with
+  //! kind ("some" or "full") of a pressure file.
+  //! \throw std::invalid_argument if there is no such line.
+  static double parse_pressure(std::string const& text,
+                               std::string const& kind);
+
+  //! Return the sum of the run queue wait times in nanoseconds of the CPUs
+  //! in cpus from the contents of /proc/schedstat.
+  static double parse_run_delay(std::string const& text, CPUSet const& cpus);
+
+  //! Describe load in a human readable way.
+  static std::string to_string(Load const& load, int cpus);
+};
+
+#endif // LoadMonitor_hpp
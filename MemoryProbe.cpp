@@ -0,0 +1,244 @@
+// MemoryProbe.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "MemoryProbe.hpp"
+#include "CPUClock.hpp"
+#include "sysfs.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Return the members of set in ascending order.
+static std::vector<int> members(CPUSet const& set)
+{
+  std::vector<int> result;
+  for (int n = set.first(), last = set.last(); n <= last; ++n) {
+    if (set.is_set(n))
+      result.push_back(n);
+  }
+  return result;
+}
+
+// Anonymous memory whose pages are all allocated on a single NUMA node.
+class NodeBuffer
+{
+protected:
+  void*  mAddr;
+  size_t mSize;
+
+public:
+  NodeBuffer(size_t size, int node) : mAddr(MAP_FAILED), mSize(size)
+  {
+    mAddr = ::mmap(nullptr, mSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mAddr)
+      throw std::system_error(errno, std::system_category(), "mmap");
+
+    // mbind fails if node is not allowed by the cpuset, and MPOL_MF_STRICT
+    // keeps the pages from silently ending up on another node.
+    size_t                     bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(node / bits + 1);
+    mask[node / bits] |= 1ul << (node % bits);
+    if (::syscall(SYS_mbind, mAddr, mSize, MPOL_BIND, mask.data(),
+                  mask.size() * bits + 1, MPOL_MF_STRICT)) {
+      int err = errno;
+      ::munmap(mAddr, mSize);
+      throw std::system_error(err, std::system_category(),
+                              "mbind(node " + std::to_string(node) + ")");
+    }
+  }
+
+  ~NodeBuffer()
+  {
+    ::munmap(mAddr, mSize);
+  }
+
+  template <typename T> T* data() const
+  {
+    return static_cast<T*>(mAddr);
+  }
+};
+
+double MemoryProbe::latency(int cpu, int node)
+{
+  CPUSet pin;
+  pin.set(cpu);
+  pin.setaffinity();
+
+  // Link the cache lines of the buffer into a single random cycle (Sattolo's
+  // algorithm), so that neither the prefetchers nor out-of-order execution
+  // can hide the latency of the loads.
+  size_t              line  = 64 / sizeof(void*);
+  size_t              lines = PROBE_LATENCY_SIZE / 64;
+  NodeBuffer          buffer(PROBE_LATENCY_SIZE, node);
+  void**              base = buffer.data<void*>();
+  std::vector<size_t> order(lines);
+  for (size_t i = 0; i < lines; ++i)
+    order[i] = i;
+  std::mt19937_64 random(cpu);
+  for (size_t i = lines - 1; i > 0; --i)
+    std::swap(order[i], order[random() % i]);
+  for (size_t i = 0; i < lines; ++i)
+    base[order[i] * line] = &base[order[(i + 1) % lines] * line];
+
+  // Walk the cycle twice, and only time the second walk, when the TLB and
+  // the page tables are as warm as they get.
+  void** p = base;
+  for (size_t i = 0; i < lines; ++i)
+    p = static_cast<void**>(*p);
+  double start = CPUClock::now();
+  for (size_t i = 0; i < lines; ++i)
+    p = static_cast<void**>(*p);
+  double elapsed = CPUClock::now() - start;
+
+  // Make sure the compiler doesn't drop the walk.
+  asm volatile("" : : "r"(p));
+  return elapsed / lines;
+}
+
+double MemoryProbe::bandwidth(CPUSet const& cpus, int node)
+{
+  std::vector<int> cpu     = members(cpus);
+  int              threads = cpu.size();
+  size_t           count = PROBE_BANDWIDTH_SIZE / 3 / sizeof(double) / threads;
+  size_t           size  = 3 * count * sizeof(double);
+
+  // Allocate the memory up front, so that a node we cannot use is reported
+  // before starting any threads.
+  std::vector<std::unique_ptr<NodeBuffer>> buffers;
+  for (int i = 0; i < threads; ++i)
+    buffers.emplace_back(new NodeBuffer(size, node));
+
+  // The threads start each pass together, and the time of a pass is the
+  // time until the slowest thread finishes. The best of several passes is
+  // reported, like STREAM does.
+  int const                passes = 5;
+  std::atomic<int>         ready(0);
+  std::vector<double>      start(passes, 0.0), end(passes, 0.0);
+  std::vector<std::thread> workers;
+  std::mutex               mutex;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&, i]() {
+      CPUSet pin;
+      pin.set(cpu[i]);
+      pin.setaffinity();
+
+      double* a = buffers[i]->data<double>();
+      double* b = a + count;
+      double* c = b + count;
+      for (size_t j = 0; j < count; ++j) {
+        a[j] = 0.0;
+        b[j] = 1.0;
+        c[j] = 2.0;
+      }
+
+      for (int pass = 0; pass < passes; ++pass) {
+        // Wait for the other threads.
+        ++ready;
+        while (ready < threads * (pass + 1))
+          ;
+        double begin = CPUClock::now();
+        for (size_t j = 0; j < count; ++j)
+          a[j] = b[j] + 3.0 * c[j];
+        double finish = CPUClock::now();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!start[pass] || (begin < start[pass]))
+          start[pass] = begin;
+        end[pass] = std::max(end[pass], finish);
+      }
+    });
+  }
+  for (std::thread& worker : workers)
+    worker.join();
+
+  double best = end[0] - start[0];
+  for (int pass = 1; pass < passes; ++pass)
+    best = std::min(best, end[pass] - start[pass]);
+  return size * threads / best;
+}
+
+void MemoryProbe::probe(CPUSet const& set, CPUTopology const& topology,
+                        std::ostream& out)
+{
+  std::vector<int> from = members(topology.nodes(set));
+  std::vector<int> to =
+      members(CPUSet(sysfs_read("/sys/devices/system/node/has_memory")));
+
+  // Measure both matrices first, as each measurement needs the CPUs to
+  // itself.
+  std::vector<std::vector<double>> latency, bandwidth;
+  for (int node : from) {
+    CPUSet cpus = topology.node(node) & set;
+    latency.emplace_back();
+    bandwidth.emplace_back();
+    for (int memory : to) {
+      try {
+        latency.back().push_back(MemoryProbe::latency(cpus.first(), memory));
+        bandwidth.back().push_back(MemoryProbe::bandwidth(cpus, memory));
+      }
+      catch (std::system_error const&) {
+        latency.back().push_back(-1.0);
+        bandwidth.back().push_back(-1.0);
+      }
+    }
+  }
+
+  // Rows are the nodes of the partition's CPUs, columns the memory nodes.
+  // Nodes the partition cannot allocate memory on are shown as '-'.
+  auto print = [&](char const* title, double scale,
+                   std::vector<std::vector<double>> const& matrix) {
+    out << title << "\n  cpus\\mem";
+    for (int memory : to)
+      out << std::setw(8) << memory;
+    out << '\n';
+    for (size_t row = 0; row < from.size(); ++row) {
+      out << std::setw(10) << from[row];
+      for (double value : matrix[row]) {
+        if (value < 0.0)
+          out << std::setw(8) << '-';
+        else
+          out << std::setw(8) << std::fixed << std::setprecision(1)
+              << value * scale;
+      }
+      out << '\n';
+    }
+  };
+  print("Memory latency (ns):", 1e9, latency);
+  print("Memory bandwidth (GB/s):", 1e-9, bandwidth);
+}
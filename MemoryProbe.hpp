@@ -0,0 +1,61 @@
+// MemoryProbe.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef MemoryProbe_hpp
+#define MemoryProbe_hpp
+
+#include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+
+#include <iosfwd>
+
+//! Size of the buffer the latency is measured on. It must be much larger than
+//! the last level cache, so that almost every load goes to memory.
+#define PROBE_LATENCY_SIZE (256ul << 20)
+//! Total size of the arrays the bandwidth is measured on.
+#define PROBE_BANDWIDTH_SIZE (768ul << 20)
+
+//! Measure the memory latency and bandwidth the CPUs of a partition get from
+//! each NUMA node, to check that a partition really gets local memory and
+//! full bandwidth.
+class MemoryProbe
+{
+public:
+  //! Return the average latency in seconds of dependent loads from memory on
+  //! node, measured by the calling thread pinned to cpu.
+  //! \throw std::system_error if memory cannot be allocated on node, e.g.
+  //! because cpuset.mems doesn't allow it.
+  static double latency(int cpu, int node);
+
+  //! Return the bandwidth in bytes per second that one thread on each CPU in
+  //! cpus gets from memory on node, using the STREAM triad kernel.
+  //! \throw std::system_error if memory cannot be allocated on node.
+  static double bandwidth(CPUSet const& cpus, int node);
+
+  //! Measure the latency and bandwidth from the CPUs of set on each of their
+  //! nodes to the memory of every node, and print them as matrices to out.
+  static void probe(CPUSet const& set, CPUTopology const& topology,
+                    std::ostream& out);
+};
+
+#endif // MemoryProbe_hpp
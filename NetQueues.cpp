@@ -0,0 +1,138 @@
+// NetQueues.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+// See https://docs.kernel.org/networking/scaling.html for a description of
+// RPS (Receive Packet Steering) and XPS (Transmit Packet Steering).
+
+#include "NetQueues.hpp"
+#include "print.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+//! Path to the network devices in sysfs
+#define NET_ROOT "/sys/class/net"
+
+NetQueues::~NetQueues()
+{
+  if (mFiles.empty())
+    return;
+  try {
+    mGroup.steer(std::vector<std::string>());
+  }
+  catch (std::exception const& e) {
+    print(2, "%s\n", e.what());
+  }
+}
+
+NetQueues::NetQueues(CPUCGroup& group, bool irqs) : mGroup(group), mIRQs(irqs)
+{
+}
+
+void NetQueues::add(std::string const& spec)
+{
+  std::string ifname = spec.substr(0, spec.find(':'));
+  CPUSet      queues;
+  if (ifname.size() < spec.size())
+    queues.parse(spec.substr(ifname.size() + 1));
+
+  // runexcl runs SUID root, so make sure the interface name cannot be used to
+  // write to anything outside of NET_ROOT.
+  if (ifname.empty() || ("." == ifname) || (".." == ifname) ||
+      (std::string::npos != ifname.find('/')))
+    throw std::invalid_argument("Invalid network interface '" + ifname + "'");
+
+  fs::path dir = fs::path(NET_ROOT) / ifname / "queues";
+  if (!fs::is_directory(dir))
+    throw std::runtime_error("No such network interface '" + ifname + "'");
+
+  size_t count = mFiles.size();
+  for (auto const& dir_entry : fs::directory_iterator(dir)) {
+    // Queue directories are named rx-<n> and tx-<n>.
+    std::string name = dir_entry.path().filename().string();
+    char const* file;
+    if (0 == name.compare(0, 3, "rx-"))
+      file = "rps_cpus";
+    else if (0 == name.compare(0, 3, "tx-"))
+      file = "xps_cpus";
+    else
+      continue;
+
+    int queue = std::atoi(name.c_str() + 3);
+    if (!queues.empty() &&
+        ((queue >= queues.max_cpus()) || !queues.is_set(queue)))
+      continue;
+
+    // xps_cpus does not exist for devices without multiqueue support.
+    fs::path path = dir_entry.path() / file;
+    if (fs::exists(path))
+      mFiles.push_back(path.string());
+  }
+
+  if (mFiles.size() == count)
+    throw std::runtime_error("No matching queues for network interface '" +
+                             ifname + "'");
+
+  if (mIRQs)
+    add_irqs(ifname, queues);
+  mGroup.steer(mFiles);
+}
+
+void NetQueues::add_irqs(std::string const& ifname, CPUSet const& queues)
+{
+  // Network drivers name their queue interrupts after the interface, e.g.
+  // 'eth0-TxRx-3' or 'eth0-rx-1', so look for those in /proc/interrupts. Each
+  // line has the form '<irq>: <count per CPU>... <chip> ... <name>'.
+  std::ifstream in("/proc/interrupts");
+  std::string   line;
+  while (std::getline(in, line)) {
+    char* end;
+    long  irq = std::strtol(line.c_str(), &end, 10);
+    if ((end == line.c_str()) || (':' != *end))
+      continue;
+
+    std::istringstream tokens(line);
+    std::string        name, token;
+    while (tokens >> token)
+      name = token;
+    if ((0 != name.compare(0, ifname.size(), ifname)) ||
+        (name.size() <= ifname.size()) || ('-' != name[ifname.size()]))
+      continue;
+
+    // The queue number is the number after the last '-'.
+    if (!queues.empty()) {
+      int queue = std::atoi(name.c_str() + name.rfind('-') + 1);
+      if ((queue >= queues.max_cpus()) || !queues.is_set(queue))
+        continue;
+    }
+
+    fs::path path =
+        fs::path("/proc/irq") / std::to_string(irq) / "smp_affinity_list";
+    mFiles.push_back(path.string());
+  }
+}
@@ -0,0 +1,61 @@
+// NetQueues.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef NetQueues_hpp
+#define NetQueues_hpp
+
+#include "CPUCGroup.hpp"
+#include "CPUSet.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+//! Steer the receive and transmit processing of network queues onto a
+//! partition's CPUs by means of RPS/XPS, and optionally move the queues'
+//! interrupts there as well. The settings are shared with other partitions
+//! steering the same queues (see CPUCGroup::steer), and restored when the
+//! last of them is done.
+class NetQueues
+{
+protected:
+  CPUCGroup&               mGroup;
+  bool                     mIRQs;
+  std::vector<std::string> mFiles;
+
+  //! Add the files for the affinity of the interrupts belonging to ifname's
+  //! queues.
+  void add_irqs(std::string const& ifname, CPUSet const& queues);
+
+public:
+  ~NetQueues();
+  NetQueues(CPUCGroup& group, bool irqs = false);
+
+  //! Steer the queues of a network interface to the CPUs. spec has the form
+  //! <ifname>[:<queues>], where <queues> is a list of queue numbers in the
+  //! same format as a CPU list. If no queues are given, all of the interface's
+  //! queues are steered.
+  void add(std::string const& spec);
+};
+
+#endif // NetQueues_hpp
@@ -0,0 +1,396 @@
+// Prewarm.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Prewarm.hpp"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <linux/mempolicy.h> // Definition of MPOL_* constants
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h> // Definition of SYS_* constants
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+//
+// Helper functions
+//
+
+// Split str at the given separator, dropping empty elements.
+static std::vector<std::string> split(std::string const& str, char separator)
+{
+  std::vector<std::string> result;
+  std::istringstream       in(str);
+  std::string              element;
+  while (std::getline(in, element, separator)) {
+    if (!element.empty())
+      result.push_back(element);
+  }
+  return result;
+}
+
+// Return the directory part of path.
+static std::string dirname(std::string const& path)
+{
+  auto pos = path.rfind('/');
+  if (std::string::npos == pos)
+    return ".";
+  return path.substr(0, pos ? pos : 1);
+}
+
+// Read the library directories from /etc/ld.so.conf, following include
+// statements. Note that ld.so actually uses /etc/ld.so.cache, which is built
+// from these directories by ldconfig.
+static void read_ld_so_conf(char const* path, std::vector<std::string>& dirs,
+                            int depth = 0)
+{
+  std::ifstream in(path);
+  std::string   line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream tokens(line);
+    std::string        token;
+    if (!(tokens >> token))
+      continue;
+
+    if (("include" == token) && (depth < 8)) {
+      while (tokens >> token) {
+        glob_t matches;
+        if (0 == ::glob(token.c_str(), 0, nullptr, &matches)) {
+          for (size_t i = 0; i < matches.gl_pathc; ++i)
+            read_ld_so_conf(matches.gl_pathv[i], dirs, depth + 1);
+        }
+        ::globfree(&matches);
+      }
+    }
+    else {
+      dirs.push_back(token);
+    }
+  }
+}
+
+// Memory mapped ELF file.
+class ELFFile
+{
+protected:
+  unsigned char* mData;
+  size_t         mSize;
+
+  template<typename Ehdr, typename Phdr, typename Dyn> void parse();
+
+  // Translate a virtual address into a pointer into the mapped file, or
+  // nullptr if the address is not backed by the file.
+  template<typename Ehdr, typename Phdr> char const* at(uint64_t addr) const;
+
+public:
+  unsigned char            mClass   = ELFCLASSNONE;
+  unsigned short           mMachine = EM_NONE;
+  std::string              mInterpreter;
+  std::vector<std::string> mNeeded;
+  std::vector<std::string> mRPath;
+  std::vector<std::string> mRunPath;
+
+  ~ELFFile()
+  {
+    if (mData)
+      ::munmap(mData, mSize);
+  }
+
+  ELFFile(std::string const& path) : mData(nullptr), mSize(0)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (-1 == fd)
+      return;
+
+    struct stat st;
+    if ((0 == ::fstat(fd, &st)) && S_ISREG(st.st_mode) &&
+        (st.st_size >= (off_t)sizeof(Elf32_Ehdr))) {
+      void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (MAP_FAILED != data) {
+        mData = static_cast<unsigned char*>(data);
+        mSize = st.st_size;
+      }
+    }
+    ::close(fd);
+
+    if (!mData || ::memcmp(mData, ELFMAG, SELFMAG))
+      return;
+
+    if ((ELFCLASS64 == mData[EI_CLASS]) && (mSize >= sizeof(Elf64_Ehdr)))
+      parse<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>();
+    else if (ELFCLASS32 == mData[EI_CLASS])
+      parse<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>();
+  }
+
+  bool valid() const
+  {
+    return ELFCLASSNONE != mClass;
+  }
+};
+
+template<typename Ehdr, typename Phdr>
+char const* ELFFile::at(uint64_t addr) const
+{
+  Ehdr const* ehdr = reinterpret_cast<Ehdr const*>(mData);
+  for (int i = 0; i < ehdr->e_phnum; ++i) {
+    Phdr const* phdr = reinterpret_cast<Phdr const*>(
+        mData + ehdr->e_phoff + i * ehdr->e_phentsize);
+    if ((PT_LOAD == phdr->p_type) && (addr >= phdr->p_vaddr) &&
+        (addr < phdr->p_vaddr + phdr->p_filesz)) {
+      uint64_t offset = addr - phdr->p_vaddr + phdr->p_offset;
+      return offset < mSize ? reinterpret_cast<char const*>(mData + offset)
+                            : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+template<typename Ehdr, typename Phdr, typename Dyn> void ELFFile::parse()
+{
+  Ehdr const* ehdr = reinterpret_cast<Ehdr const*>(mData);
+  if ((ehdr->e_phoff + (uint64_t)ehdr->e_phnum * ehdr->e_phentsize > mSize) ||
+      (ehdr->e_phentsize < sizeof(Phdr)))
+    return;
+
+  mClass   = mData[EI_CLASS];
+  mMachine = ehdr->e_machine;
+
+  Phdr const* dynamic = nullptr;
+  for (int i = 0; i < ehdr->e_phnum; ++i) {
+    Phdr const* phdr = reinterpret_cast<Phdr const*>(
+        mData + ehdr->e_phoff + i * ehdr->e_phentsize);
+    if ((PT_INTERP == phdr->p_type) &&
+        (phdr->p_offset + phdr->p_filesz <= mSize))
+      mInterpreter.assign(reinterpret_cast<char const*>(mData) +
+                              phdr->p_offset,
+                          ::strnlen(reinterpret_cast<char const*>(mData) +
+                                        phdr->p_offset,
+                                    phdr->p_filesz));
+    else if (PT_DYNAMIC == phdr->p_type)
+      dynamic = phdr;
+  }
+  if (!dynamic || (dynamic->p_offset + dynamic->p_filesz > mSize))
+    return;
+
+  // The dynamic section references strings by their offset into the string
+  // table, whose (virtual) address is given by the DT_STRTAB entry.
+  Dyn const*  dyn    = reinterpret_cast<Dyn const*>(mData + dynamic->p_offset);
+  size_t      n      = dynamic->p_filesz / sizeof(Dyn);
+  char const* strtab = nullptr;
+  uint64_t    strsz  = 0;
+  for (size_t i = 0; (i < n) && (DT_NULL != dyn[i].d_tag); ++i) {
+    if (DT_STRTAB == dyn[i].d_tag)
+      strtab = at<Ehdr, Phdr>(dyn[i].d_un.d_ptr);
+    else if (DT_STRSZ == dyn[i].d_tag)
+      strsz = dyn[i].d_un.d_val;
+  }
+  if (!strtab || (strtab + strsz > reinterpret_cast<char*>(mData) + mSize))
+    return;
+
+  for (size_t i = 0; (i < n) && (DT_NULL != dyn[i].d_tag); ++i) {
+    uint64_t offset = dyn[i].d_un.d_val;
+    if (offset >= strsz)
+      continue;
+    std::string str(strtab + offset,
+                    ::strnlen(strtab + offset, strsz - offset));
+    if (DT_NEEDED == dyn[i].d_tag)
+      mNeeded.push_back(str);
+    else if (DT_RPATH == dyn[i].d_tag)
+      mRPath = split(str, ':');
+    else if (DT_RUNPATH == dyn[i].d_tag)
+      mRunPath = split(str, ':');
+  }
+}
+
+//
+// Protected/private member functions
+//
+
+void Prewarm::add_elf(std::string const& path)
+{
+  // Check for access first, as the ELFFile is opened with root privileges.
+  if ((0 != ::access(path.c_str(), R_OK)) ||
+      (mFiles.end() != std::find(mFiles.begin(), mFiles.end(), path)))
+    return;
+  mFiles.push_back(path);
+
+  ELFFile elf(path);
+  if (!elf.valid())
+    return;
+
+  if (!elf.mInterpreter.empty())
+    add(elf.mInterpreter);
+
+  for (std::string const& name : elf.mNeeded) {
+    std::string library = find_library(name, dirname(path), elf.mRPath,
+                                       elf.mRunPath, elf.mClass, elf.mMachine);
+    if (!library.empty())
+      add_elf(library);
+  }
+}
+
+std::string Prewarm::find_library(std::string const&              name,
+                                  std::string const&              origin,
+                                  std::vector<std::string> const& rpath,
+                                  std::vector<std::string> const& runpath,
+                                  unsigned char                   elf_class,
+                                  unsigned short                  machine)
+{
+  if (std::string::npos != name.find('/'))
+    return name;
+
+  // Search order as described in ld.so(8): DT_RPATH (only if there is no
+  // DT_RUNPATH), LD_LIBRARY_PATH, DT_RUNPATH, ld.so.conf, default paths.
+  std::vector<std::string> dirs;
+  if (runpath.empty())
+    dirs = rpath;
+  if (char const* env = ::getenv("LD_LIBRARY_PATH")) {
+    for (std::string const& dir : split(env, ':'))
+      dirs.push_back(dir);
+  }
+  dirs.insert(dirs.end(), runpath.begin(), runpath.end());
+  if (mSystemDirs.empty()) {
+    read_ld_so_conf("/etc/ld.so.conf", mSystemDirs);
+    for (char const* dir : {"/lib64", "/usr/lib64", "/lib", "/usr/lib"})
+      mSystemDirs.push_back(dir);
+  }
+  dirs.insert(dirs.end(), mSystemDirs.begin(), mSystemDirs.end());
+
+  for (std::string dir : dirs) {
+    auto pos = dir.find("$ORIGIN");
+    if (std::string::npos != pos)
+      dir.replace(pos, 7, origin);
+
+    // Skip libraries for a different architecture (e.g. 32 bit libraries in
+    // a 64 bit system's /usr/lib).
+    std::string path = dir + "/" + name;
+    if (0 != ::access(path.c_str(), R_OK))
+      continue;
+    ELFFile elf(path);
+    if (elf.valid() && (elf.mClass == elf_class) && (elf.mMachine == machine))
+      return path;
+  }
+
+  return std::string();
+}
+
+void Prewarm::run(std::vector<std::string> files, CPUSet nodes)
+{
+  // Page cache pages are allocated according to the memory policy of the
+  // thread reading the file, so prefer the partition's nodes. We cannot
+  // simply run the thread on the partition's CPUs, as those are exclusive to
+  // the partition's cgroup.
+  unsigned long mask[16] = {0};
+  int           maxnode  = sizeof(mask) * CHAR_BIT;
+  bool          any      = false;
+  for (int node = 0; (node < maxnode) && (node < nodes.max_cpus()); ++node) {
+    if (nodes.is_set(node)) {
+      mask[node / (sizeof(long) * CHAR_BIT)] |=
+          1ul << (node % (sizeof(long) * CHAR_BIT));
+      any = true;
+    }
+  }
+  if (any)
+    ::syscall(SYS_set_mempolicy, MPOL_PREFERRED_MANY, mask, maxnode + 1);
+
+  // First start asynchronous readahead for all files so that the I/O for
+  // them can proceed in parallel, then map them with MAP_POPULATE to wait
+  // until they are actually in the page cache.
+  std::vector<int> fds;
+  for (std::string const& file : files) {
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (-1 != fd) {
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      fds.push_back(fd);
+    }
+  }
+
+  for (int fd : fds) {
+    struct stat st;
+    if ((0 == ::fstat(fd, &st)) && (st.st_size > 0)) {
+      void* data = ::mmap(nullptr, st.st_size, PROT_READ,
+                          MAP_SHARED | MAP_POPULATE, fd, 0);
+      if (MAP_FAILED != data)
+        ::munmap(data, st.st_size);
+    }
+    ::close(fd);
+  }
+}
+
+//
+// Public interface
+//
+
+Prewarm::~Prewarm()
+{
+  wait();
+}
+
+void Prewarm::add_executable(char const* name)
+{
+  // Search PATH the same way execvp does.
+  if (::strchr(name, '/')) {
+    add_elf(name);
+    return;
+  }
+
+  char const* env = ::getenv("PATH");
+  for (std::string const& dir : split(env ? env : "/bin:/usr/bin", ':')) {
+    std::string path = dir + "/" + name;
+    if (0 == ::access(path.c_str(), X_OK)) {
+      add_elf(path);
+      return;
+    }
+  }
+}
+
+void Prewarm::add(std::string const& path)
+{
+  // runexcl runs SUID root, so use access(2) to check if the real user can
+  // read the file. We don't want to leak information about files the user has
+  // no access to, even if it is only through the page cache.
+  if (0 != ::access(path.c_str(), R_OK))
+    return;
+  if (mFiles.end() == std::find(mFiles.begin(), mFiles.end(), path))
+    mFiles.push_back(path);
+}
+
+void Prewarm::start(CPUSet const& nodes)
+{
+  wait();
+  mThread = std::thread(run, mFiles, nodes);
+}
+
+void Prewarm::wait()
+{
+  if (mThread.joinable())
+    mThread.join();
+}
@@ -0,0 +1,74 @@
+// Prewarm.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Prewarm_hpp
+#define Prewarm_hpp
+
+#include "CPUSet.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Load files into the page cache in a background thread, so that a command
+//! doesn't pay for page cache misses on its executable, shared libraries, and
+//! input files when it starts.
+class Prewarm
+{
+protected:
+  std::vector<std::string> mFiles;
+  std::vector<std::string> mSystemDirs;
+  std::thread              mThread;
+
+  //! Add the ELF file path and (recursively) the shared libraries it needs.
+  void add_elf(std::string const& path);
+  //! Find the shared library name needed by the ELF file origin.
+  std::string find_library(std::string const&              name,
+                           std::string const&              origin,
+                           std::vector<std::string> const& rpath,
+                           std::vector<std::string> const& runpath,
+                           unsigned char                   elf_class,
+                           unsigned short                  machine);
+
+  static void run(std::vector<std::string> files, CPUSet nodes);
+
+public:
+  ~Prewarm();
+
+  //! Add the executable that execvp would run for name, along with its
+  //! program interpreter and the shared libraries it depends on.
+  void add_executable(char const* name);
+
+  //! Add a file. Files the (real) user running runexcl cannot read are
+  //! ignored.
+  void add(std::string const& path);
+
+  //! Start loading the files in a background thread. Page cache pages are
+  //! preferably allocated from the NUMA nodes in nodes.
+  void start(CPUSet const& nodes);
+
+  //! Wait until all files are loaded.
+  void wait();
+};
+
+#endif // Prewarm_hpp
@@ -0,0 +1,231 @@
+// Quota.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Quota.hpp"
+#include "parse.hpp"
+
+#include <grp.h>
+#include <pwd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+// Return the names of user uid and group gid, or empty strings if they have
+// none. A static runexcl cannot load the NSS modules, so it only consults the
+// local files.
+#ifdef RUNEXCL_STATIC
+static std::string user_name(uid_t uid)
+{
+  std::string name;
+  if (FILE* fp = ::fopen("/etc/passwd", "re")) {
+    while (struct passwd* pw = ::fgetpwent(fp)) {
+      if (pw->pw_uid == uid) {
+        name = pw->pw_name;
+        break;
+      }
+    }
+    ::fclose(fp);
+  }
+  return name;
+}
+
+static std::string group_name(gid_t gid)
+{
+  std::string name;
+  if (FILE* fp = ::fopen("/etc/group", "re")) {
+    while (struct group* gr = ::fgetgrent(fp)) {
+      if (gr->gr_gid == gid) {
+        name = gr->gr_name;
+        break;
+      }
+    }
+    ::fclose(fp);
+  }
+  return name;
+}
+#else
+static std::string user_name(uid_t uid)
+{
+  struct passwd* pw = ::getpwuid(uid);
+  return pw ? pw->pw_name : "";
+}
+
+static std::string group_name(gid_t gid)
+{
+  struct group* gr = ::getgrgid(gid);
+  return gr ? gr->gr_name : "";
+}
+#endif
+
+// Return the section for the user or group with the given name or numeric id.
+static Config::Section const* find(Config const& config, char const* type,
+                                   std::string const& name, unsigned id)
+{
+  Config::Section const* section = nullptr;
+  if (!name.empty())
+    section = config.section(type, name);
+  if (!section)
+    section = config.section(type, std::to_string(id));
+  return section;
+}
+
+// Return the frequency modes of the comma separated list str.
+static unsigned parse_frequency_modes(std::string const& str)
+{
+  std::istringstream in(str);
+  std::string        mode;
+  unsigned           modes = 0;
+  while (std::getline(in >> std::ws, mode, ',')) {
+    mode.erase(mode.find_last_not_of(" \t") + 1);
+    if ("any" == mode)
+      modes |= Quota::FrequencyAny;
+    else if ("fixed" == mode)
+      modes |= Quota::FrequencyFixed;
+    else if ("max" == mode)
+      modes |= Quota::FrequencyMax;
+    else if ("min" == mode)
+      modes |= Quota::FrequencyMin;
+    else if ("nonlinear" == mode)
+      modes |= Quota::FrequencyNonlinear;
+    else if ("none" != mode)
+      throw std::invalid_argument("unknown frequency mode '" + mode + "'");
+  }
+  return modes;
+}
+
+// Return the limits of section.
+static Quota parse_quota(Config::Section const& section)
+{
+  Quota quota;
+  for (auto const& value : section.mValues) {
+    try {
+      if ("max-cpus" == value.first)
+        quota.mCPUs = parse_long(value.second, -1, INT_MAX);
+      else if ("max-isolated" == value.first)
+        quota.mIsolated = parse_long(value.second, -1, INT_MAX);
+      else if ("frequency" == value.first)
+        quota.mFrequencyModes = parse_frequency_modes(value.second);
+      else if ("net-queues" == value.first)
+        quota.mNetQueues = parse_bool(value.second);
+      else if ("boost" == value.first)
+        quota.mBoost = parse_bool(value.second);
+      else
+        throw std::invalid_argument("unknown key '" + value.first + "'");
+    }
+    catch (std::exception const& e) {
+      throw std::runtime_error(section.mType + " '" + section.mName +
+                               "': " + e.what());
+    }
+  }
+  return quota;
+}
+
+// Return the larger of two limits, where -1 means no limit.
+static int max_limit(int a, int b)
+{
+  return ((-1 == a) || (-1 == b)) ? -1 : std::max(a, b);
+}
+
+Quota::Quota(Config const& config, uid_t uid, std::vector<gid_t> const& gids)
+{
+  if (!uid)
+    return;
+
+  auto const* section = find(config, "user", user_name(uid), uid);
+  if (section) {
+    *this = parse_quota(*section);
+    return;
+  }
+
+  bool found = false;
+  for (gid_t gid : gids) {
+    if (!(section = find(config, "group", group_name(gid), gid)))
+      continue;
+
+    Quota quota = parse_quota(*section);
+    if (!found) {
+      *this = quota;
+      found = true;
+    }
+    else {
+      mCPUs           = max_limit(mCPUs, quota.mCPUs);
+      mIsolated       = max_limit(mIsolated, quota.mIsolated);
+      mFrequencyModes |= quota.mFrequencyModes;
+      mNetQueues      = mNetQueues || quota.mNetQueues;
+      mBoost          = mBoost || quota.mBoost;
+    }
+  }
+
+  if (!found && (section = config.section("user", "*")))
+    *this = parse_quota(*section);
+}
+
+void Quota::check_frequency(double frequency) const
+{
+  unsigned mode;
+  if (0.0 == frequency)
+    return;
+  else if (FREQUENCY_MAX == frequency)
+    mode = FrequencyMax;
+  else if (FREQUENCY_MIN == frequency)
+    mode = FrequencyMin;
+  else if (FREQUENCY_NONLINEAR == frequency)
+    mode = FrequencyNonlinear;
+  else
+    mode = FrequencyFixed;
+
+  if (!(mFrequencyModes & mode))
+    throw std::runtime_error("Frequency mode not permitted by quota");
+}
+
+void Quota::check_net_queues() const
+{
+  if (!mNetQueues)
+    throw std::runtime_error("Steering network queues not permitted by quota");
+}
+
+void Quota::check_boost() const
+{
+  if (!mBoost)
+    throw std::runtime_error("Boosting not permitted by quota");
+}
+
+void Quota::check(Usage const& usage, int cpus, bool isolate) const
+{
+  if ((-1 != mCPUs) && (usage.mCPUs + cpus > mCPUs))
+    throw std::runtime_error("Quota exceeded: " + std::to_string(cpus) +
+                             " CPUs requested, " +
+                             std::to_string(usage.mCPUs) + " of " +
+                             std::to_string(mCPUs) + " in use");
+
+  if (isolate && (-1 != mIsolated) && (usage.mIsolated + cpus > mIsolated))
+    throw std::runtime_error("Quota exceeded: " + std::to_string(cpus) +
+                             " isolated CPUs requested, " +
+                             std::to_string(usage.mIsolated) + " of " +
+                             std::to_string(mIsolated) + " in use");
+}
@@ -0,0 +1,104 @@
+// Quota.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Quota_hpp
+#define Quota_hpp
+
+#include "Config.hpp"
+
+#include <sys/types.h>
+
+#include <vector>
+
+//! CPUs used by the partitions of a user.
+struct Usage
+{
+  //! Number of CPUs in all partitions.
+  int mCPUs = 0;
+  //! Number of CPUs in isolated partitions.
+  int mIsolated = 0;
+};
+
+//! Limits on the partitions a user may create. The limits are configured in
+//! '[user <name>]' and '[group <name>]' sections of the configuration, where
+//! a '[user *]' section applies to users without a section of their own and
+//! without a section for any of their groups.
+class Quota
+{
+public:
+  //! Frequency modes (see parse_frequency) a user may select.
+  enum FrequencyMode
+  {
+    FrequencyFixed     = 1,
+    FrequencyMax       = 2,
+    FrequencyMin       = 4,
+    FrequencyNonlinear = 8,
+    FrequencyAny       = 15
+  };
+
+  //! Maximum number of CPUs in all partitions of the user, -1 for no limit.
+  int mCPUs = -1;
+  //! Maximum number of CPUs in isolated partitions of the user, -1 for no
+  //! limit.
+  int mIsolated = -1;
+  //! Frequency modes the user may select.
+  unsigned mFrequencyModes = FrequencyAny;
+  //! Whether the user may steer network queues onto their partitions.
+  bool mNetQueues = true;
+  //! Whether the user may boost their partitions by parking the free CPUs.
+  bool mBoost = true;
+
+  //! Create a quota without any limits.
+  Quota() = default;
+
+  //! Look up the quota of user uid with the groups gids in config. If the
+  //! user has a section of their own, it is used; otherwise, the user gets
+  //! the most generous limits of all of their groups' sections. root is never
+  //! limited.
+  //! \throw std::runtime_error if a section contains invalid values.
+  Quota(Config const& config, uid_t uid, std::vector<gid_t> const& gids);
+
+  bool unlimited() const
+  {
+    return (-1 == mCPUs) && (-1 == mIsolated) &&
+           (FrequencyAny == mFrequencyModes) && mNetQueues && mBoost;
+  }
+
+  //! Check that frequency (see parse_frequency) may be selected.
+  //! \throw std::runtime_error if it may not.
+  void check_frequency(double frequency) const;
+
+  //! Check that the user may steer network queues.
+  //! \throw std::runtime_error if they may not.
+  void check_net_queues() const;
+
+  //! Check that the user may boost their partitions.
+  //! \throw std::runtime_error if they may not.
+  void check_boost() const;
+
+  //! Check that a partition with cpus CPUs may be added to usage.
+  //! \throw std::runtime_error if this would exceed the quota.
+  void check(Usage const& usage, int cpus, bool isolate) const;
+};
+
+#endif // Quota_hpp
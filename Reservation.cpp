@@ -0,0 +1,112 @@
+// Reservation.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Reservation.hpp"
+
+#include <signal.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+std::string Reservation::window() const
+{
+  char      buffer[64];
+  struct tm tm;
+  std::strftime(buffer, sizeof(buffer), "%F %T - ",
+                ::localtime_r(&mStart, &tm));
+  std::string str(buffer);
+  std::strftime(buffer, sizeof(buffer), "%F %T", ::localtime_r(&mEnd, &tm));
+  return str + buffer;
+}
+
+Reservations::Reservations(std::string const& str)
+{
+  std::istringstream in(str);
+  std::string        line;
+  while (std::getline(in, line)) {
+    if (line.empty())
+      continue;
+
+    std::istringstream fields(line);
+    Reservation        reservation;
+    long long          start, end;
+    std::string        cpus;
+    if (!(fields >> reservation.mPID >> reservation.mUID >> start >> end >>
+          cpus))
+      throw std::invalid_argument("Invalid reservation '" + line + "'");
+    reservation.mStart = start;
+    reservation.mEnd   = end;
+    reservation.mCPUs  = CPUSet(cpus);
+    mReservations.push_back(reservation);
+  }
+}
+
+void Reservations::prune(time_t now)
+{
+  // runexcl runs as root, so kill only fails with ESRCH if the process is
+  // gone. A reused pid keeps a stale reservation alive until its window
+  // ends, which is harmless.
+  auto stale = [now](Reservation const& reservation) {
+    return (reservation.mEnd <= now) ||
+           (::kill(reservation.mPID, 0) && (ESRCH == errno));
+  };
+  mReservations.erase(std::remove_if(mReservations.begin(),
+                                     mReservations.end(), stale),
+                      mReservations.end());
+}
+
+CPUSet Reservations::reserved(time_t start, time_t end, pid_t except) const
+{
+  CPUSet set;
+  for (Reservation const& reservation : mReservations) {
+    if ((reservation.mPID != except) && reservation.overlaps(start, end))
+      set |= reservation.mCPUs;
+  }
+  return set;
+}
+
+void Reservations::remove(pid_t pid)
+{
+  mReservations.erase(std::remove_if(mReservations.begin(),
+                                     mReservations.end(),
+                                     [pid](Reservation const& reservation) {
+                                       return reservation.mPID == pid;
+                                     }),
+                      mReservations.end());
+}
+
+std::string Reservations::to_string() const
+{
+  std::string str;
+  for (Reservation const& reservation : mReservations) {
+    str += std::to_string(reservation.mPID) + ' ' +
+           std::to_string(reservation.mUID) + ' ' +
+           std::to_string((long long)reservation.mStart) + ' ' +
+           std::to_string((long long)reservation.mEnd) + ' ' +
+           reservation.mCPUs.to_string() + '\n';
+  }
+  return str;
+}
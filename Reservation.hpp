@@ -0,0 +1,99 @@
+// Reservation.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef Reservation_hpp
+#define Reservation_hpp
+
+#include "CPUSet.hpp"
+
+#include <sys/types.h>
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+//! CPUs reserved for a time window. The reservation is held by the runexcl
+//! process pid, which creates the partition for it when the window starts.
+struct Reservation
+{
+  //! Process holding the reservation.
+  pid_t mPID = 0;
+  //! User the reservation was made for.
+  uid_t mUID = 0;
+  //! Start of the window, in seconds since the epoch.
+  time_t mStart = 0;
+  //! End of the window, in seconds since the epoch.
+  time_t mEnd = 0;
+  //! Reserved CPUs.
+  CPUSet mCPUs;
+
+  //! Return true if the window overlaps [start, end).
+  bool overlaps(time_t start, time_t end) const
+  {
+    return (mStart < end) && (start < mEnd);
+  }
+
+  //! Return the window as 'YYYY-MM-DD HH:MM:SS - YYYY-MM-DD HH:MM:SS' in
+  //! local time.
+  std::string window() const;
+};
+
+//! The reservations of a slice. They are stored as text, one reservation
+//! per line, in the form '<pid> <uid> <start> <end> <cpus>'.
+class Reservations
+{
+protected:
+  std::vector<Reservation> mReservations;
+
+public:
+  Reservations() = default;
+
+  //! Parse the reservations in str.
+  //! \throw std::invalid_argument if str is malformed.
+  explicit Reservations(std::string const& str);
+
+  std::vector<Reservation> const& reservations() const
+  {
+    return mReservations;
+  }
+
+  //! Remove the reservations that ended before now, and those whose process
+  //! no longer exists.
+  void prune(time_t now);
+
+  //! Return the CPUs reserved for windows overlapping [start, end), except
+  //! those reserved by process except.
+  CPUSet reserved(time_t start, time_t end, pid_t except = 0) const;
+
+  void add(Reservation const& reservation)
+  {
+    mReservations.push_back(reservation);
+  }
+
+  //! Remove the reservations held by process pid.
+  void remove(pid_t pid);
+
+  std::string to_string() const;
+};
+
+#endif // Reservation_hpp
@@ -0,0 +1,146 @@
+// parse.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "parse.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+
+double parse_frequency(std::string const& str)
+{
+  char const* first = str.c_str();
+  char*       last;
+  double      freq = ::strtod(first, &last);
+  if (last == first) {
+    if ("max" == str)
+      return FREQUENCY_MAX;
+    else if ("min" == str)
+      return FREQUENCY_MIN;
+    else if ("nonlinear" == str)
+      return FREQUENCY_NONLINEAR;
+  }
+  else if (freq > 0.0) {
+    std::string unit(last);
+    if (unit.empty() || ("Hz" == unit))
+      return freq;
+    else if (("k" == unit) || ("kHz" == unit))
+      return freq * 1000.0;
+    else if (("M" == unit) || ("MHz" == unit))
+      return freq * 1000000.0;
+    else if (("G" == unit) || ("GHz" == unit))
+      return freq * 1000000000.0;
+    else
+      throw std::invalid_argument("Invalid CPU frequency '" + str +
+                                  "' - unknown unit");
+  }
+
+  throw std::invalid_argument("Invalid CPU frequency '" + str + "'");
+}
+
+bool parse_bool(std::string const& str)
+{
+  if (("yes" == str) || ("true" == str) || ("on" == str) || ("1" == str))
+    return true;
+  else if (("no" == str) || ("false" == str) || ("off" == str) ||
+           ("0" == str))
+    return false;
+
+  throw std::invalid_argument("Invalid boolean value '" + str + "'");
+}
+
+long parse_long(std::string const& str, long min, long max)
+{
+  char const* first = str.c_str();
+  char*       last;
+  errno      = 0;
+  long value = ::strtol(first, &last, 10);
+  if ((last == first) || *last || errno || (value < min) || (value > max))
+    throw std::invalid_argument("invalid value '" + str + "'");
+  return value;
+}
+
+double parse_duration(std::string const& str)
+{
+  char const* first = str.c_str();
+  char*       last;
+  double      duration = ::strtod(first, &last);
+  if ((last != first) && (duration >= 0.0)) {
+    std::string unit(last);
+    if (unit.empty() || ("s" == unit))
+      return duration;
+    else if ("m" == unit)
+      return duration * 60.0;
+    else if ("h" == unit)
+      return duration * 3600.0;
+    else if ("d" == unit)
+      return duration * 86400.0;
+  }
+
+  throw std::invalid_argument("Invalid duration '" + str + "'");
+}
+
+time_t parse_time(std::string const& str, time_t now)
+{
+  if (!str.empty() && ('+' == str[0]))
+    return now + (time_t)parse_duration(str.substr(1));
+
+  if (!str.empty() && ('@' == str[0])) {
+    char*     last;
+    long long seconds = ::strtoll(str.c_str() + 1, &last, 10);
+    if ((last != str.c_str() + 1) && !*last)
+      return seconds;
+  }
+  else if (str.find('T') != std::string::npos) {
+    struct tm   tm   = {};
+    char const* last = ::strptime(str.c_str(), "%Y-%m-%dT%H:%M", &tm);
+    if (last && *last)
+      last = ::strptime(last, ":%S", &tm);
+    if (last && !*last) {
+      tm.tm_isdst = -1;
+      return ::mktime(&tm);
+    }
+  }
+  else {
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    tm.tm_sec        = 0;
+    char const* last = ::strptime(str.c_str(), "%H:%M", &tm);
+    if (last && *last)
+      last = ::strptime(last, ":%S", &tm);
+    if (last && !*last) {
+      // Use the next time the clock shows the given time.
+      tm.tm_isdst   = -1;
+      time_t result = ::mktime(&tm);
+      if (result <= now) {
+        tm.tm_mday += 1;
+        tm.tm_isdst = -1;
+        result      = ::mktime(&tm);
+      }
+      return result;
+    }
+  }
+
+  throw std::invalid_argument("Invalid time '" + str + "'");
+}
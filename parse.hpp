@@ -0,0 +1,64 @@
+// parse.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef parse_hpp
+#define parse_hpp
+
+#include <ctime>
+#include <string>
+
+//! Special values returned by parse_frequency.
+#define FREQUENCY_MAX -1.0
+#define FREQUENCY_MIN -2.0
+#define FREQUENCY_NONLINEAR -3.0
+
+//! Parse a frequency specification.
+//! \param str Either a frequency with an optional unit (Hz if none is given),
+//! a fraction of the maximum frequency between 0 and 1, or one of the special
+//! values 'max', 'min', and 'nonlinear'.
+//! \return Frequency in Hz, the fraction, or one of the FREQUENCY_* values.
+//! \throw std::invalid_argument if str is not a valid frequency.
+double parse_frequency(std::string const& str);
+
+//! Parse a boolean value ('yes', 'no', 'true', 'false', 'on', 'off', '1', or
+//! '0').
+//! \throw std::invalid_argument if str is not a valid boolean value.
+bool parse_bool(std::string const& str);
+
+//! Parse a decimal number in [min, max].
+//! \throw std::invalid_argument if str is not a number in that range.
+long parse_long(std::string const& str, long min, long max);
+
+//! Parse a duration, i.e. a number with an optional unit 's' (the default),
+//! 'm', 'h', or 'd'.
+//! \return Duration in seconds.
+//! \throw std::invalid_argument if str is not a valid duration.
+double parse_duration(std::string const& str);
+
+//! Parse a point in time, given as 'HH:MM[:SS]' (the next time the local
+//! clock shows that time after now), 'YYYY-MM-DDTHH:MM[:SS]' (local time),
+//! '+<duration>' (relative to now), or '@<seconds since the epoch>'.
+//! \throw std::invalid_argument if str is not a valid time.
+time_t parse_time(std::string const& str, time_t now);
+
+#endif // parse_hpp
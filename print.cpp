@@ -0,0 +1,76 @@
+// print.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "print.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+
+// Write size bytes from data to fd, retrying on partial writes. Errors are
+// ignored, as there is nobody left to report them to.
+static void write_all(int fd, char const* data, size_t size)
+{
+  while (size) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (EINTR == errno)
+        continue;
+      return;
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+void print(int fd, char const* format, ...)
+{
+  // Most messages fit into the buffer on the stack, so only format twice if
+  // they don't.
+  char    buffer[512];
+  va_list args;
+  va_start(args, format);
+  int n = ::vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (n < 0)
+    return;
+
+  if ((size_t)n < sizeof(buffer)) {
+    write_all(fd, buffer, n);
+  }
+  else {
+    std::string str(n, '\0');
+    va_start(args, format);
+    ::vsnprintf(&str[0], n + 1, format, args);
+    va_end(args);
+    write_all(fd, str.data(), n);
+  }
+}
+
+void print(int fd, std::string const& str)
+{
+  write_all(fd, str.data(), str.size());
+}
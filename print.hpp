@@ -0,0 +1,39 @@
+// print.hpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+#ifndef print_hpp
+#define print_hpp
+
+#include <string>
+
+//! Write a printf-style formatted message to the file descriptor fd with a
+//! single write(2). runexcl uses this instead of iostreams on its launch
+//! path, which keeps the iostream and locale initialization out of the
+//! startup time of every command it runs.
+void print(int fd, char const* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+//! Write str to the file descriptor fd.
+void print(int fd, std::string const& str);
+
+#endif // print_hpp
@@ -22,20 +22,42 @@
 // Eric.Doenges@gmx.net
 //
 
+#include "Benchmark.hpp"
 #include "CPUCGroup.hpp"
+#include "CPUClock.hpp"
+#include "Config.hpp"
+#include "CoreLatency.hpp"
+#include "Filler.hpp"
 #include "CPUGovernor.hpp"
 #include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+#include "LoadMonitor.hpp"
+#include "MemoryProbe.hpp"
+#include "NetQueues.hpp"
+#include "Prewarm.hpp"
+#include "Quota.hpp"
+#include "parse.hpp"
+#include "print.hpp"
 
 // Standard C++ headers
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <system_error>
+#include <thread>
+#include <vector>
 
 // Standard C headers
 #include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 
 // GNU/Linux headers
 #include <dirent.h>
@@ -44,44 +66,106 @@
 #include <sched.h> // Definition of CLONE_* constants
 #include <signal.h>
 #include <sys/file.h>
+#include <sys/mman.h> // for memfd_create
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/syscall.h> // Definition of SYS_* constants
 #include <sys/wait.h>
 #include <unistd.h>
 
 struct RunExclArgs
 {
-  CPUSet mSet;
-  double mFrequency;
-  bool   mIsolate;
+  CPUSet                   mSet;
+  int                      mCount;
+  std::string              mPool;
+  std::string              mClass;
+  double                   mFrequency;
+  bool                     mIsolate;
+  std::vector<std::string> mNetQueues;
+  bool                     mNetIRQs;
+  bool                     mPrewarm;
+  std::vector<std::string> mPrewarmFiles;
+  int                      mFreqLatencySamples;
+  bool                     mAllModes;
+  int                      mWarmup;
+  bool                     mBoost;
+  bool                     mReserve;
+  time_t                   mAt;
+  double                   mFor;
+  std::string              mScratchSize;
+  std::string              mScratchPath;
+  int                      mCompact;
+  bool                     mMigrateMemory;
+  bool                     mDetachCleanup;
+  bool                     mCoreSched;
+  double                   mOversubscription;
+  std::string              mSessionCreate;
+  std::string              mSession;
+  std::string              mSessionClose;
+  double                   mIdleTimeout;
+  std::string              mFiller;
+  double                   mFillerGuard;
+  bool                     mProbeMemory;
+  bool                     mMeasureTopology;
+  int                      mRepeat;
+  int                      mWarmupRuns;
+  std::vector<std::string> mAB;
 } gArgs;
 
-// Helper class to save and restore I/O stream format manipulators.
-// Requires C++17 class template argument deduction (CTAD).
-template<typename CharT, typename Traits> class ScopedIOSFormat
+// Values for long options that have no short equivalent.
+enum
 {
-public:
-  typedef std::basic_ios<CharT, Traits> basic_ios;
-
-  explicit ScopedIOSFormat(basic_ios& stream)
-    : mStream{stream}, mSaved{nullptr}
-  {
-    mSaved.copyfmt(stream);
-  }
+  OPT_POOL = 256,
+  OPT_CLASS,
+  OPT_NET_QUEUES,
+  OPT_NET_IRQS,
+  OPT_PREWARM,
+  OPT_MEASURE_FREQ_LATENCY,
+  OPT_ALL_MODES,
+  OPT_WARMUP,
+  OPT_BOOST,
+  OPT_RESERVE,
+  OPT_AT,
+  OPT_FOR,
+  OPT_SCRATCH,
+  OPT_COMPACT,
+  OPT_MIGRATE_MEMORY,
+  OPT_DETACH_CLEANUP,
+  OPT_CORE_SCHED,
+  OPT_DETECT_OVERSUBSCRIPTION,
+  OPT_SESSION_CREATE,
+  OPT_SESSION,
+  OPT_SESSION_CLOSE,
+  OPT_IDLE_TIMEOUT,
+  OPT_FILLER,
+  OPT_FILLER_GUARD,
+  OPT_PROBE_MEMORY,
+  OPT_MEASURE_TOPOLOGY,
+  OPT_REPEAT,
+  OPT_WARMUP_RUNS,
+  OPT_AB,
+};
 
-  ~ScopedIOSFormat()
-  {
-    mStream.copyfmt(mSaved);
-  }
+// When a reservation starts, the partition has already been set up for this
+// many seconds, so that it is tuned by the time the command runs.
+#define RESERVATION_LEAD 60
 
-protected:
-  basic_ios& mStream;
-  basic_ios  mSaved;
-};
+// A session that nothing has run in for this many seconds is closed, unless
+// --idle-timeout says otherwise.
+#define SESSION_IDLE_TIMEOUT 600
 
-void print_usage(std::ostream& out, int width, int base_indent, int tab_indent,
+// Print the usage text to fd, breaking lines at width columns. Each line of
+// usage consists of an option, a '\t', and the description, which is indented
+// to tab_indent columns.
+void print_usage(int fd, int width, int base_indent, int tab_indent,
                  const char* usage)
 {
-  ScopedIOSFormat guard(out);
+  std::string out;
+  auto        append = [&](int indent, int first, int n) {
+    out.append(std::max(indent, 0), ' ').append(&usage[first], n);
+  };
 
   int  pos = 0, first = 0, last = 0, indent = base_indent, columns = width;
   char c;
@@ -91,7 +175,7 @@ void print_usage(std::ostream& out, int width, int base_indent, int tab_indent,
     } // Possible linebreak at space character
     else if ('\t' == c) {
       int n = pos - first;
-      out << std::setw(n + indent) << std::string(&usage[first], n);
+      append(indent, first, n);
       first = pos + 1;
       last  = first;
       columns -= (n + indent);
@@ -99,15 +183,15 @@ void print_usage(std::ostream& out, int width, int base_indent, int tab_indent,
     }
     else if ('\n' == c) {
       int n = pos - first + 1;
-      out << std::setw(n + indent) << std::string(&usage[first], n);
+      append(indent, first, n);
       first   = pos + 1;
       indent  = base_indent;
       columns = width;
     } // Newline
     else if ((pos - first) >= (columns - indent)) {
       int n = last - first;
-      out << std::setw(n + indent) << std::string(&usage[first], n)
-          << std::endl;
+      append(indent, first, n);
+      out += '\n';
       first   = last + 1;
       indent  = tab_indent;
       columns = width;
@@ -115,34 +199,690 @@ void print_usage(std::ostream& out, int width, int base_indent, int tab_indent,
 
     pos += 1;
   }
+
+  print(fd, out);
+}
+
+// Return the real group and the supplementary groups of the calling user.
+static std::vector<gid_t> groups()
+{
+  std::vector<gid_t> gids(::getgroups(0, nullptr));
+  int                n = ::getgroups(gids.size(), gids.data());
+  if (-1 == n)
+    throw std::system_error(errno, std::system_category(), "getgroups");
+  gids.resize(n);
+  gids.push_back(::getgid());
+  return gids;
+}
+
+// Set the environment variable name to value. If overwrite is false, an
+// existing value is kept.
+static void set_environment(char const* name, std::string const& value,
+                            bool overwrite = false)
+{
+  if (::setenv(name, value.c_str(), overwrite))
+    throw std::system_error(errno, std::system_category(), "setenv");
+}
+
+// Tell the command which CPUs it runs on, so that runtimes like OpenMP or Go
+// size and pin their thread pools to the partition instead of the whole
+// system. Settings the user made explicitly are left alone, except for the
+// RUNEXCL_* variables.
+static void export_environment(CPUSet const& set, CPUTopology const& topology)
+{
+  std::string count = std::to_string(set.count());
+
+  // Use one OpenMP place per physical core. CPUTopology::cores orders them by
+  // last level cache, so with OMP_PROC_BIND=close, neighbouring threads share
+  // a cache. Note that OpenMP uses a different syntax for ranges than CPU
+  // lists, so we always list each CPU separately.
+  std::string places;
+  for (CPUSet const& core : topology.cores(set)) {
+    places += places.empty() ? "{" : ",{";
+    for (int cpu = core.first(), last = core.last(); cpu <= last; ++cpu) {
+      if (core.is_set(cpu)) {
+        if ('{' != places.back())
+          places.push_back(',');
+        places += std::to_string(cpu);
+      }
+    }
+    places.push_back('}');
+  }
+
+  set_environment("RUNEXCL_CPUS", set.to_string(), true);
+  set_environment("OMP_NUM_THREADS", count);
+  set_environment("OMP_PLACES", places);
+  set_environment("OMP_PROC_BIND", "close");
+  set_environment("GOMAXPROCS", count);
+
+  // Provide the topology of the partition through an anonymous file that the
+  // command inherits. This avoids having to clean up a temporary file after
+  // the command terminates.
+  int fd = ::memfd_create("runexcl-topology", 0);
+  if (-1 == fd)
+    throw std::system_error(errno, std::system_category(), "memfd_create");
+
+  std::string description = topology.to_string(set);
+  if (::write(fd, description.data(), description.size()) !=
+      (ssize_t)description.size())
+    throw std::system_error(errno, std::system_category(),
+                            "write topology description");
+  set_environment("RUNEXCL_TOPOLOGY", "/proc/self/fd/" + std::to_string(fd),
+                  true);
+}
+
+// Close all open file descriptors except stdin, stdout, and stderr. Note that
+// we don't use std::filesystem::directory_iterator here because getting at the
+// necessary information is more convenient using the POSIX APIs directly.
+static void close_fds()
+{
+  DIR* dir = ::opendir("/proc/self/fd");
+  if (dir) {
+    int dfd = ::dirfd(dir);
+    for (struct dirent* entry; entry = ::readdir(dir);) {
+      // /proc/self/fd should only contain '.', '..', or names consisting
+      // only of digits. strtol will return 0 for '.' and '..', so we
+      // don't need to check for invalid characters in strtol.
+      int fd = ::strtol(entry->d_name, nullptr, 10);
+      if ((fd > 2) && (fd != dfd))
+        ::close(fd);
+    }
+    ::closedir(dir);
+  }
+}
+
+// Fork a background process. The process detaches from the terminal and all
+// of runexcl's file descriptors, so that it doesn't hold up whoever waits for
+// runexcl's output. Returns like fork.
+static pid_t daemonize()
+{
+  pid_t pid = ::fork();
+  if (pid)
+    return pid;
+
+  ::setsid();
+  int null = ::open("/dev/null", O_RDWR);
+  if (-1 != null) {
+    ::dup2(null, 0);
+    ::dup2(null, 1);
+    ::dup2(null, 2);
+  }
+  close_fds();
+  return 0;
+}
+
+// Restore the frequency settings kept for their grace period in a background
+// process once they are due, so that runexcl can return right away.
+static void restore_later()
+{
+  pid_t pid = daemonize();
+  if (-1 == pid)
+    throw std::system_error(errno, std::system_category(), "fork");
+  else if (pid)
+    return;
+
+  try {
+    for (double wait; (wait = CPUGovernor::restore_idle()) > 0.0;)
+      std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+  }
+  catch (std::exception const&) {
+  }
+  _exit(0);
+}
+
+// Start the filler command in the partition's filler cgroup. Like the
+// command, it runs with the user's privileges and runexcl's original signal
+// mask.
+static Filler* start_filler(CPUCGroup const& group, CPUSet set,
+                            sigset_t const& signals)
+{
+  std::unique_ptr<Filler> filler(
+      new Filler(group.path(), set.count(), gArgs.mFillerGuard));
+  pid_t pid = ::fork();
+  if (-1 == pid)
+    throw std::system_error(errno, std::system_category(), "fork");
+  else if (!pid) {
+    try {
+      filler->enter();
+      set.setaffinity();
+      if (::setgid(getgid()) || ::setuid(getuid()))
+        throw std::system_error(errno, std::system_category(),
+                                "Could not drop privileges:");
+
+      // The filler must not compete with the command for its input.
+      int null = ::open("/dev/null", O_RDONLY);
+      if (-1 != null)
+        ::dup2(null, 0);
+      close_fds();
+
+      if (::sigprocmask(SIG_SETMASK, &signals, NULL))
+        throw std::system_error(errno, std::system_category(),
+                                "sigprocmask");
+      ::execl("/bin/sh", "sh", "-c", gArgs.mFiller.c_str(), (char*)nullptr);
+      throw std::system_error(errno, std::system_category(), "/bin/sh");
+    }
+    catch (std::exception& e) {
+      print(2, "Filler: %s\n", e.what());
+      _exit(1);
+    }
+  }
+
+  filler->watch(pid);
+  return filler.release();
+}
+
+// Wait until the given time. Returns false if one of signals arrives first.
+static bool wait_until(time_t when, sigset_t const& signals)
+{
+  for (time_t now; (now = ::time(nullptr)) < when;) {
+    struct timespec timeout = {when - now, 0};
+    if (::sigtimedwait(&signals, nullptr, &timeout) > 0)
+      return false;
+  }
+  return true;
+}
+
+// Hold the partition of a session until one of signals arrives, or nothing
+// has run in it for idle seconds (never if idle is 0).
+static void hold_session(CPUCGroup const& group, double idle,
+                         sigset_t const& signals)
+{
+  time_t last = ::time(nullptr);
+  while (wait_until(::time(nullptr) + 1, signals)) {
+    time_t now = ::time(nullptr);
+    if (group.populated())
+      last = now;
+    else if ((idle > 0.0) && (now - last >= idle))
+      break;
+  }
+}
+
+// Close the calling user's session name, and wait until the process holding
+// it has removed the partition.
+static int close_session(std::string const& name)
+{
+  pid_t holder;
+  if (CPUCGroup::find_session(name, ::getuid(), holder).empty()) {
+    print(2, "No session '%s'\n", name.c_str());
+    return 1;
+  }
+
+  // We signal the holder as root, so make sure it is still the holder: a
+  // pidfd keeps referring to the process it was opened for, so checking the
+  // session again after opening it rules out a process that reused the pid.
+  pid_t again = 0;
+  int   pidfd = ::syscall(SYS_pidfd_open, holder, 0);
+  if ((-1 == pidfd) ||
+      CPUCGroup::find_session(name, ::getuid(), again).empty() ||
+      (again != holder)) {
+    print(2, "Session '%s' has ended\n", name.c_str());
+    return 1;
+  }
+  if (::syscall(SYS_pidfd_send_signal, pidfd, SIGTERM, nullptr, 0)) {
+    print(2, "Cannot close session '%s': %s\n", name.c_str(),
+          strerror(errno));
+    ::close(pidfd);
+    return 1;
+  }
+
+  // The pidfd becomes readable when the holder has exited.
+  struct pollfd fd = {pidfd, POLLIN, 0};
+  while ((-1 == ::poll(&fd, 1, -1)) && (EINTR == errno))
+    ;
+  ::close(pidfd);
+  return 0;
+}
+
+// Mount a tmpfs of the given size on path, with its pages allocated from
+// nodes. Must be called in the child, which has its own mount namespace, while
+// it still has root privileges. When the last process of the namespace exits,
+// i.e. when the partition is empty, the tmpfs and its contents are gone.
+static void mount_scratch(std::string const& path, std::string const& size,
+                          CPUSet const& nodes)
+{
+  // Don't let the mount propagate back into the parent's namespace.
+  if (::mount(nullptr, "/", nullptr, MS_REC | MS_SLAVE, nullptr))
+    throw std::system_error(errno, std::system_category(),
+                            "Making mounts private failed");
+
+  // Hiding a directory the user can't write to could trick SUID programs
+  // into trusting files the user put there, so only allow directories owned
+  // by the user, or sticky world writable ones like /tmp. We mount through
+  // the descriptor so path can't be swapped after the check.
+  int fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (-1 == fd)
+    throw std::system_error(errno, std::system_category(), path);
+  struct stat st;
+  if (::fstat(fd, &st))
+    throw std::system_error(errno, std::system_category(), "fstat");
+  bool own = st.st_uid == ::getuid();
+  if (!own && ((st.st_mode & (S_ISVTX | S_IWOTH)) != (S_ISVTX | S_IWOTH)))
+    throw std::runtime_error("Cannot mount scratch space on '" + path +
+                             "': not owned by the user or world writable");
+
+  std::string options =
+      "size=" + size + ",mpol=bind:" + nodes.to_string() +
+      (own ? ",mode=0700,uid=" + std::to_string(::getuid()) +
+                 ",gid=" + std::to_string(::getgid())
+           : std::string(",mode=1777"));
+
+  std::string target = "/proc/self/fd/" + std::to_string(fd);
+  if (::mount("runexcl-scratch", target.c_str(), "tmpfs", MS_NOSUID | MS_NODEV,
+              options.c_str()))
+    throw std::system_error(errno, std::system_category(),
+                            "Mounting scratch space on '" + path + "' failed");
+  ::close(fd);
+}
+
+// Spin all CPUs in set until they run at the frequency the governor targets,
+// but for at most timeout seconds. This gets the CPUs out of deep idle states
+// and low P-states, so the command doesn't start out running slowly. Must be
+// called from inside the partition.
+static int warm_up(CPUSet const& set, CPUGovernor const& governor,
+                   double timeout)
+{
+  double                   deadline = CPUClock::now() + timeout;
+  std::vector<std::thread> threads;
+  std::vector<int>         cold;
+  std::mutex               mutex;
+
+  for (int cpu = set.first(), last = set.last(); cpu <= last; ++cpu) {
+    if (!set.is_set(cpu))
+      continue;
+
+    double target = 0.95 * governor.target_frequency(cpu);
+    threads.emplace_back([cpu, target, deadline, &cold, &mutex]() {
+      try {
+        CPUSet pin;
+        pin.set(cpu);
+        pin.setaffinity();
+
+        CPUClock clock;
+        while (CPUClock::now() < deadline) {
+          if ((target > 0.0) && (clock.frequency(0.001) >= target))
+            return;
+        }
+        if (target > 0.0) {
+          std::lock_guard<std::mutex> lock(mutex);
+          cold.push_back(cpu);
+        }
+      }
+      catch (std::exception& e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        print(2, "%s\n", e.what());
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (!cold.empty()) {
+    std::string cpus;
+    for (int cpu : cold)
+      cpus += ' ' + std::to_string(cpu);
+    print(2,
+          "Warning: CPU(s)%s did not reach the target frequency during "
+          "warm-up.\n",
+          cpus.c_str());
+  }
+  return 0;
+}
+
+// Clone a child process running argv directly into the partition, and return
+// its pid. The child restores the signal mask osignals before calling execvp.
+static pid_t start_command(CPUCGroup& group, CPUSet set,
+                           CPUTopology const& topology, char** argv,
+                           sigset_t const& osignals)
+{
+  // Clone the child process directly into the cgroup. Additionally add the
+  // CLONE_VFORK flag to the clone system call because the parent process
+  // doesn't need to run until the child process calls execve (actually, it
+  // only needs to run after the child process terminates).
+  pid_t child = group.clone(CLONE_VFORK |
+                            (gArgs.mScratchSize.empty() ? 0 : CLONE_NEWNS));
+  if (-1 == child) {
+    throw std::system_error(errno, std::system_category(),
+                            "clone3() failed:");
+  }
+  else if (!child) {
+    try {
+      // Set the main thread's CPU affinity mask.
+      set.setaffinity();
+
+      // Create a core scheduling cookie for the command. It covers all of
+      // its threads, and is inherited by the processes it starts.
+      if (gArgs.mCoreSched &&
+          ::prctl(PR_SCHED_CORE, PR_SCHED_CORE_CREATE, 0,
+                  PR_SCHED_CORE_SCOPE_THREAD_GROUP, 0))
+        throw std::system_error(errno, std::system_category(),
+                                "Could not enable core scheduling:");
+
+      if (!gArgs.mScratchSize.empty())
+        mount_scratch(gArgs.mScratchPath, gArgs.mScratchSize,
+                      topology.nodes(set));
+
+      // Drop root privileges. Since runexcl will run as a SUID binary, it
+      // should not be necessary to fiddle with the supplementary groups, as
+      // those should be set correctly for the user running the binary - we
+      // only need to drop the primary group in case the group S-bit is also
+      // set on the binary.
+      if (::setgid(getgid()) || ::setuid(getuid()))
+        throw std::system_error(errno, std::system_category(),
+                                "Could not drop privileges:");
+
+      // Close all open file descriptors except stdin, stdout, and stderr.
+      // This is necessary because we cannot be sure all file descriptors
+      // where opened with the FD_CLOEXEC flag.
+      close_fds();
+
+      // Export the description of the partition to the command. This must
+      // happen after closing the file descriptors, as it creates one.
+      export_environment(set, topology);
+
+      /*
+       * The child inherits the signal mask from the parent, so we restore
+       * the signal mask the parent had before we blocked any signals in
+       * main.
+       */
+      if (::sigprocmask(SIG_SETMASK, &osignals, NULL))
+        throw std::system_error(errno, std::system_category(),
+                                "sigprocmask");
+
+      if (execvp(argv[0], argv))
+        throw std::system_error(errno, std::system_category(), argv[0]);
+    }
+    catch (std::exception& e) {
+      print(2, "%s\n", e.what());
+      // Call _exit because we don't want to call the cpugroup destructor in
+      // the child.
+      _exit(1);
+    }
+  } // Child process
+  return child;
+}
+
+// Wait for the command to terminate, and return its exit status, or 128 plus
+// the number of the signal that killed it, as shells do.
+static int wait_command(pid_t child)
+{
+  int status;
+  if (-1 == waitpid(child, &status, 0))
+    throw std::system_error(errno, std::system_category(),
+                            "waitpid() failed:");
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Run argv in the partition and wait until it terminates, watching it for
+// oversubscription and running the filler alongside it if requested. Returns
+// the command's exit status (see wait_command).
+static int run_command(CPUCGroup& group, CPUSet const& set,
+                       CPUTopology const& topology, char** argv,
+                       sigset_t const& osignals)
+{
+  // The child is cloned with clone3, which doesn't run the C library's fork
+  // handlers, so no other thread may exist while it is created, as the child
+  // could inherit a locked allocator. Start the helper threads afterwards.
+  pid_t child = start_command(group, set, topology, argv, osignals);
+
+  // Watch the command for more runnable threads than CPUs while it runs.
+  std::unique_ptr<LoadMonitor> monitor;
+  if (gArgs.mOversubscription > 0.0)
+    monitor.reset(new LoadMonitor(group.path(), set, gArgs.mOversubscription));
+
+  // Harvest the CPU time the command leaves idle.
+  std::unique_ptr<Filler> filler;
+  if (!gArgs.mFiller.empty())
+    filler.reset(start_filler(group, set, osignals));
+
+  int code = wait_command(child);
+
+  if (monitor) {
+    monitor->stop();
+    std::string report = monitor->report();
+    if (!report.empty())
+      print(2, "Warning: the command was %s.\n", report.c_str());
+  }
+  if (filler) {
+    filler->stop();
+    print(2, "Filler %s.\n", filler->report().c_str());
+  }
+  return code;
+}
+
+// Run the command gArgs.mRepeat times after gArgs.mWarmupRuns runs that are
+// left out of the statistics, or with --ab, each of the two configurations
+// that often, and report the statistics of the runs. Stops at the first
+// failed run, and returns its exit status.
+static int run_benchmark(CPUCGroup& group, CPUSet const& set,
+                         CPUTopology const& topology, char** argv,
+                         sigset_t const& osignals)
+{
+  // Build the command line of each configuration up front, so the runs don't
+  // differ in the work done before execvp.
+  int                                   configs = gArgs.mAB.empty() ? 1 : 2;
+  std::vector<std::vector<std::string>> words(configs);
+  std::vector<std::vector<char*>>       argvs(configs);
+  for (int config = 0; config < configs; ++config) {
+    for (char** arg = argv; *arg; ++arg)
+      words[config].push_back(*arg);
+    if (!gArgs.mAB.empty()) {
+      std::istringstream in(gArgs.mAB[config]);
+      for (std::string word; in >> word;)
+        words[config].push_back(word);
+    }
+    if (words[config].empty())
+      throw std::runtime_error("No command for configuration " +
+                               std::string(config ? "B" : "A"));
+    for (std::string& word : words[config])
+      argvs[config].push_back(&word[0]);
+    argvs[config].push_back(nullptr);
+  }
+
+  // With two configurations, run them in the order A B B A A B B A ..., so a
+  // drift (e.g. as the machine heats up) affects both alike.
+  Benchmark benchmark(group.path());
+  int       warmup = gArgs.mWarmupRuns * configs;
+  int       runs   = warmup + gArgs.mRepeat * configs;
+  int       code   = 0;
+  for (int run = 0; !code && (run < runs); ++run) {
+    int               config = (configs > 1) ? ((run + 1) / 2) % 2 : 0;
+    Benchmark::Sample from   = benchmark.sample();
+    code = run_command(group, set, topology, argvs[config].data(), osignals);
+    Benchmark::Sample to = benchmark.sample();
+    if (code)
+      print(2, "Run %d failed with exit status %d.\n", run + 1, code);
+    else if (run >= warmup)
+      benchmark.add(config, from, to);
+  }
+
+  if (benchmark.runs(0) + benchmark.runs(1))
+    print(2, benchmark.report());
+  return code;
 }
 
 void usage(int exit_code)
 {
-  std::cerr << "Usage: runexcl [OPTION]... COMMAND [PARAMS]...\n";
+  print(2, "Usage: runexcl [OPTION]... COMMAND [PARAMS]...\n"
+           "   or: runexcl [OPTION]... --session-create <name> "
+           "[--idle-timeout <duration>]\n"
+           "   or: runexcl [OPTION]... --session <name> COMMAND [PARAMS]...\n"
+           "   or: runexcl --session-close <name>\n"
+           "   or: runexcl [OPTION]... --reserve <list>|<n> --at <time> "
+           "--for <duration>\n"
+           "               COMMAND [PARAMS]...\n"
+           "   or: runexcl [OPTION]... --repeat <n> [--warmup-runs <k>] "
+           "COMMAND [PARAMS]...\n"
+           "   or: runexcl [OPTION]... --repeat <n> [--warmup-runs <k>] "
+           "--ab <A> <B>\n"
+           "               [COMMAND [PARAMS]...]\n"
+           "   or: runexcl [OPTION]... --measure-freq-latency[=<n>]\n"
+           "   or: runexcl [OPTION]... --probe-memory\n"
+           "   or: runexcl [OPTION]... --measure-topology\n"
+           "   or: runexcl [--pool <name>] --compact[=<n>] "
+           "[--migrate-memory]\n");
   print_usage(
-      std::cerr, 79, 2, 28,
+      2, 79, 2, 28,
       "-c, --cpu-list <list>\tList of CPUs to use.\n"
+      "-n, --count <n>\tNumber of CPUs to use, selected automatically.\n"
+      "--pool <name>\tTake the CPUs from the named pool.\n"
+      "--class membw|cache|compute\tLabel the partition with the command's "
+      "job class, and keep it away from the last level caches or NUMA nodes "
+      "of partitions of the same class as configured for the pool.\n"
       "-f, --frequency <freq>|max|min|nonlinear\tFrequency to set CPUs to.\n"
       "-i, --isolate\tIsolate selected CPUs.\n"
+      "--net-queues <if>[:<queues>]\tSteer the network interface's receive "
+      "and transmit processing onto the selected CPUs.\n"
+      "--net-irqs\tAlso move the interrupts of the steered network queues "
+      "to the selected CPUs.\n"
+      "--prewarm[=<files>]\tLoad the command's executable and shared "
+      "libraries, and the comma separated list of files, into the page cache "
+      "before running the command.\n"
+      "--warmup <ms>\tSpin the selected CPUs for up to ms milliseconds "
+      "until they reach their target frequency before running the command.\n"
+      "--boost\tRun the slice's free CPUs at their lowest frequency while "
+      "the command runs, leaving more turbo headroom to the partitions.\n"
+      "--reserve <list>|<n>\tReserve the listed CPUs, or n CPUs selected "
+      "automatically, for the window given by --at and --for, and run the "
+      "command on them when the window starts.\n"
+      "--at <time>\tStart of the reservation: HH:MM[:SS], "
+      "YYYY-MM-DDTHH:MM[:SS], +<duration>, or @<seconds since the epoch>.\n"
+      "--scratch <size>[:<path>]\tMount a private tmpfs of the given size "
+      "(e.g. 4G or 10%) on path (default /tmp) for the command, with its "
+      "memory on the NUMA nodes of the selected CPUs.\n"
+      "--for <duration>\tLength of the reservation, or how long the command "
+      "is expected to run, in s, m, h, or d (default s).\n"
+      "--repeat <n>\tRun the command n times in the same partition, and "
+      "report the mean, median, 95% confidence interval, and outliers of "
+      "its wall and CPU time.\n"
+      "--warmup-runs <k>\tWith --repeat, run the command k more times "
+      "first, and leave these runs out of the statistics.\n"
+      "--ab <A> <B>\tWith --repeat, compare two configurations, whose words "
+      "are appended to the command, running each n times interleaved, and "
+      "report whether their difference is significant.\n"
+      "--measure-freq-latency[=<n>]\tInstead of running a command, measure "
+      "how long frequency changes take to become effective on the first "
+      "selected CPU, using n samples (default 100), in the current mode of "
+      "the cpufreq driver.\n"
+      "--all-modes\tWith --measure-freq-latency, measure in every mode of "
+      "the cpufreq driver. Switching modes affects all CPUs, so only root "
+      "may do this, and only while no other partitions exist.\n"
+      "--probe-memory\tInstead of running a command, measure the memory "
+      "latency and bandwidth from the selected CPUs of each NUMA node to the "
+      "memory of every node.\n"
+      "--measure-topology\tInstead of running a command, measure the "
+      "latency between each pair of selected cores, group them into "
+      "clusters, and (as root) save the result to the topology cache.\n"
+      "--compact[=<n>]\tInstead of running a command, move up to n (default "
+      "all) running partitions of the pool to other CPUs, so that the free "
+      "CPUs share as few last level caches as possible. Only root may do "
+      "this.\n"
+      "--migrate-memory\tWith --compact, also migrate the memory of the "
+      "moved partitions to the NUMA nodes of their new CPUs.\n"
+      "--core-sched\tGive the command its own core scheduling cookie, so "
+      "that nothing else runs on the SMT siblings of its CPUs at the same "
+      "time.\n"
+      "--detect-oversubscription[=<duration>]\tWarn if the command has more "
+      "runnable threads than CPUs for duration (default 5s).\n"
+      "--session-create <name>\tInstead of running a command, keep the "
+      "partition and its settings as the named session until it is closed.\n"
+      "--idle-timeout <duration>\tClose the session once nothing has run in "
+      "it for duration (default 10m, 0 for never).\n"
+      "--session <name>\tRun the command in the named session instead of a "
+      "partition of its own.\n"
+      "--session-close <name>\tClose the named session once the commands "
+      "running in it have terminated.\n"
+      "--filler <command>\tRun the shell command with the SCHED_IDLE policy "
+      "on the CPU time the command leaves idle, until the command ends.\n"
+      "--filler-guard <percent>\tFreeze the filler while the command's "
+      "threads wait for a CPU more than percent of the time (default 5).\n"
+      "--detach-cleanup\tExit as soon as the command has terminated, and "
+      "tear down the partition in the background.\n"
+      "-V, --version\tPrint the version and exit.\n"
       "\n");
   exit(exit_code);
 }
 
 static struct option sLongOptions[] = {{"cpu-list", required_argument, nullptr,
                                         'c'},
+                                       {"count", required_argument, nullptr,
+                                        'n'},
+                                       {"pool", required_argument, nullptr,
+                                        OPT_POOL},
+                                       {"class", required_argument, nullptr,
+                                        OPT_CLASS},
                                        {"frequency", required_argument,
                                         nullptr, 'f'},
                                        {"isolate", no_argument, nullptr, 'i'},
+                                       {"net-queues", required_argument,
+                                        nullptr, OPT_NET_QUEUES},
+                                       {"net-irqs", no_argument, nullptr,
+                                        OPT_NET_IRQS},
+                                       {"prewarm", optional_argument, nullptr,
+                                        OPT_PREWARM},
+                                       {"warmup", required_argument, nullptr,
+                                        OPT_WARMUP},
+                                       {"boost", no_argument, nullptr,
+                                        OPT_BOOST},
+                                       {"reserve", required_argument, nullptr,
+                                        OPT_RESERVE},
+                                       {"at", required_argument, nullptr,
+                                        OPT_AT},
+                                       {"for", required_argument, nullptr,
+                                        OPT_FOR},
+                                       {"scratch", required_argument, nullptr,
+                                        OPT_SCRATCH},
+                                       {"compact", optional_argument, nullptr,
+                                        OPT_COMPACT},
+                                       {"migrate-memory", no_argument,
+                                        nullptr, OPT_MIGRATE_MEMORY},
+                                       {"core-sched", no_argument, nullptr,
+                                        OPT_CORE_SCHED},
+                                       {"detect-oversubscription",
+                                        optional_argument, nullptr,
+                                        OPT_DETECT_OVERSUBSCRIPTION},
+                                       {"session-create", required_argument,
+                                        nullptr, OPT_SESSION_CREATE},
+                                       {"session", required_argument, nullptr,
+                                        OPT_SESSION},
+                                       {"session-close", required_argument,
+                                        nullptr, OPT_SESSION_CLOSE},
+                                       {"idle-timeout", required_argument,
+                                        nullptr, OPT_IDLE_TIMEOUT},
+                                       {"filler", required_argument, nullptr,
+                                        OPT_FILLER},
+                                       {"filler-guard", required_argument,
+                                        nullptr, OPT_FILLER_GUARD},
+                                       {"detach-cleanup", no_argument,
+                                        nullptr, OPT_DETACH_CLEANUP},
+                                       {"probe-memory", no_argument, nullptr,
+                                        OPT_PROBE_MEMORY},
+                                       {"measure-topology", no_argument,
+                                        nullptr, OPT_MEASURE_TOPOLOGY},
+                                       {"repeat", required_argument, nullptr,
+                                        OPT_REPEAT},
+                                       {"warmup-runs", required_argument,
+                                        nullptr, OPT_WARMUP_RUNS},
+                                       {"ab", required_argument, nullptr,
+                                        OPT_AB},
+                                       {"measure-freq-latency",
+                                        optional_argument, nullptr,
+                                        OPT_MEASURE_FREQ_LATENCY},
+                                       {"all-modes", no_argument, nullptr,
+                                        OPT_ALL_MODES},
                                        {"verbose", no_argument, nullptr, 'v'},
+                                       {"version", no_argument, nullptr, 'V'},
                                        {nullptr, 0, nullptr, 0}};
 
 int main(int argc, char** argv)
 {
+  gArgs.mIdleTimeout = SESSION_IDLE_TIMEOUT;
+  gArgs.mFillerGuard = 5.0;
+
   int c, index;
   // The '+' tells getopt_long not to rearange the options.
   while (-1 !=
-         (c = getopt_long(argc, argv, "+c:f:iv", sLongOptions, &index))) {
+         (c = getopt_long(argc, argv, "+c:f:in:vV", sLongOptions, &index))) {
     switch (c) {
     case 'c': // cpu
       try {
@@ -151,74 +891,320 @@ int main(int argc, char** argv)
           gArgs.mSet |= set;
       }
       catch (std::invalid_argument const& e) {
-        std::cerr << "Invalid CPU specification: " << e.what() << std::endl;
+        print(2, "Invalid CPU specification: %s\n", e.what());
         ::exit(1);
       }
       break;
 
     case 'f':
-    {
-      char* last;
-      gArgs.mFrequency = strtod(optarg, &last);
-      if (last == optarg) {
-        if (!strcmp("max", last)) {
-          gArgs.mFrequency = -1.0;
-        }
-        else if (!strcmp("min", last)) {
-          gArgs.mFrequency = -2.0;
-        }
-        else if (!strcmp("nonlinear", last)) {
-          gArgs.mFrequency = -3.0;
-        }
-        else {
-          std::cerr << "Invalid CPU frequency argument" << std::endl;
+      try {
+        gArgs.mFrequency = parse_frequency(optarg);
+      }
+      catch (std::invalid_argument const& e) {
+        print(2, "%s\n", e.what());
+        ::exit(1);
+      }
+      break;
+
+    case 'n':
+      gArgs.mCount = ::atoi(optarg);
+      if (gArgs.mCount <= 0) {
+        print(2, "Invalid number of CPUs\n");
+        ::exit(1);
+      }
+      break;
+
+    case 'i': // isolated
+      gArgs.mIsolate = true;
+      break;
+
+    case 'v': // verbose
+      break;
+
+    case 'V':
+      print(1, "runexcl " RUNEXCL_VERSION "\n");
+      return 0;
+
+    case OPT_POOL:
+      gArgs.mPool = optarg;
+      break;
+
+    case OPT_CLASS: {
+      char const* classes[] = {JOB_CLASSES};
+      if (std::find_if(std::begin(classes), std::end(classes),
+                       [](char const* name) {
+                         return !std::strcmp(name, optarg);
+                       }) == std::end(classes)) {
+        print(2, "Invalid job class '%s'\n", optarg);
+        ::exit(1);
+      }
+      gArgs.mClass = optarg;
+      break;
+    }
+
+    case OPT_NET_QUEUES:
+      gArgs.mNetQueues.push_back(optarg);
+      break;
+
+    case OPT_NET_IRQS:
+      gArgs.mNetIRQs = true;
+      break;
+
+    case OPT_PREWARM:
+      gArgs.mPrewarm = true;
+      if (optarg) {
+        std::istringstream files(optarg);
+        std::string        file;
+        while (std::getline(files, file, ','))
+          gArgs.mPrewarmFiles.push_back(file);
+      }
+      break;
+
+    case OPT_WARMUP:
+      gArgs.mWarmup = ::atoi(optarg);
+      if (gArgs.mWarmup <= 0) {
+        print(2, "Invalid warm-up time\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_BOOST:
+      gArgs.mBoost = true;
+      break;
+
+    case OPT_RESERVE:
+      // A plain number is a count, anything else a list of CPUs, so a single
+      // CPU must be given as a range like '4-4'.
+      gArgs.mReserve = true;
+      if (std::strspn(optarg, "0123456789") == std::strlen(optarg)) {
+        gArgs.mCount = ::atoi(optarg);
+        if (gArgs.mCount <= 0) {
+          print(2, "Invalid number of CPUs\n");
           ::exit(1);
         }
       }
       else {
-        if (gArgs.mFrequency <= 0.0) {
-          std::cerr << "Invalid CPU frequency argument" << std::endl;
-          ::exit(1);
-        }
-        else if (!strcmp("k", last) || !strcmp("kHz", last)) {
-          gArgs.mFrequency *= 1000.0;
-        }
-        else if (!strcmp("M", last) || !strcmp("MHz", last)) {
-          gArgs.mFrequency *= 1000000.0;
+        try {
+          gArgs.mSet |= CPUSet(optarg);
         }
-        else if (!strcmp("G", last) || !strcmp("GHz", last)) {
-          gArgs.mFrequency *= 1000000000.0;
-        }
-        else if (last[0] != '\0') {
-          std::cerr << "Invalid CPU frequency argument - unknown unit"
-                    << std::endl;
+        catch (std::invalid_argument const& e) {
+          print(2, "Invalid CPU specification: %s\n", e.what());
+          ::exit(1);
         }
       }
-    } break;
+      break;
 
-    case 'i': // isolated
-      gArgs.mIsolate = true;
+    case OPT_SCRATCH: {
+      // tmpfs accepts sizes with a k, m, g, t, or % suffix.
+      std::string arg(optarg);
+      auto        colon  = arg.find(':');
+      gArgs.mScratchSize = arg.substr(0, colon);
+      gArgs.mScratchPath =
+          (std::string::npos != colon) ? arg.substr(colon + 1) : "/tmp";
+      std::string const& size   = gArgs.mScratchSize;
+      auto               digits = size.find_first_not_of("0123456789");
+      if (!digits || size.empty() ||
+          ((std::string::npos != digits) &&
+           ((digits + 1 != size.size()) ||
+            !std::strchr("kKmMgGtT%", size[digits]))) ||
+          ('/' != gArgs.mScratchPath[0])) {
+        print(2, "Invalid scratch space specification '%s'\n", optarg);
+        ::exit(1);
+      }
       break;
+    }
 
-    case 'v': // verbose
+    case OPT_COMPACT:
+      gArgs.mCompact = optarg ? ::atoi(optarg) : INT_MAX;
+      if (gArgs.mCompact <= 0) {
+        print(2, "Invalid number of moves\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_MIGRATE_MEMORY:
+      gArgs.mMigrateMemory = true;
+      break;
+
+    case OPT_CORE_SCHED:
+      gArgs.mCoreSched = true;
+      break;
+
+    case OPT_DETECT_OVERSUBSCRIPTION:
+      try {
+        gArgs.mOversubscription = optarg ? parse_duration(optarg) : 5.0;
+      }
+      catch (std::invalid_argument const& e) {
+        print(2, "%s\n", e.what());
+        ::exit(1);
+      }
+      if (gArgs.mOversubscription <= 0.0) {
+        print(2, "Invalid duration\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_SESSION_CREATE:
+    case OPT_SESSION:
+    case OPT_SESSION_CLOSE:
+      // Session names are stored in a space separated record.
+      if (!*optarg || (std::strspn(optarg,
+                                   "abcdefghijklmnopqrstuvwxyz"
+                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                   "0123456789._-") != std::strlen(optarg))) {
+        print(2, "Invalid session name '%s'\n", optarg);
+        ::exit(1);
+      }
+      (OPT_SESSION_CREATE == c ? gArgs.mSessionCreate
+       : OPT_SESSION == c      ? gArgs.mSession
+                               : gArgs.mSessionClose) = optarg;
+      break;
+
+    case OPT_IDLE_TIMEOUT:
+      try {
+        gArgs.mIdleTimeout = parse_duration(optarg);
+      }
+      catch (std::invalid_argument const& e) {
+        print(2, "%s\n", e.what());
+        ::exit(1);
+      }
+      break;
+
+    case OPT_FILLER:
+      gArgs.mFiller = optarg;
+      break;
+
+    case OPT_FILLER_GUARD:
+      gArgs.mFillerGuard = ::atof(optarg);
+      if (gArgs.mFillerGuard <= 0.0) {
+        print(2, "Invalid percentage\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_DETACH_CLEANUP:
+      gArgs.mDetachCleanup = true;
+      break;
+
+    case OPT_AT:
+    case OPT_FOR:
+      try {
+        if (OPT_AT == c)
+          gArgs.mAt = parse_time(optarg, ::time(nullptr));
+        else
+          gArgs.mFor = parse_duration(optarg);
+      }
+      catch (std::invalid_argument const& e) {
+        print(2, "%s\n", e.what());
+        ::exit(1);
+      }
+      break;
+
+    case OPT_PROBE_MEMORY:
+      gArgs.mProbeMemory = true;
+      break;
+
+    case OPT_MEASURE_TOPOLOGY:
+      gArgs.mMeasureTopology = true;
+      break;
+
+    case OPT_REPEAT:
+      gArgs.mRepeat = ::atoi(optarg);
+      if (gArgs.mRepeat < 2) {
+        print(2, "Invalid number of runs\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_WARMUP_RUNS:
+      gArgs.mWarmupRuns = ::atoi(optarg);
+      if (gArgs.mWarmupRuns < 0) {
+        print(2, "Invalid number of warm-up runs\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_AB:
+      // --ab takes two arguments, the second of which getopt_long leaves to
+      // us.
+      if ((optind >= argc) || !gArgs.mAB.empty())
+        usage(1);
+      gArgs.mAB.push_back(optarg);
+      gArgs.mAB.push_back(argv[optind++]);
+      break;
+
+    case OPT_MEASURE_FREQ_LATENCY:
+      gArgs.mFreqLatencySamples = optarg ? ::atoi(optarg) : 100;
+      if (gArgs.mFreqLatencySamples <= 0) {
+        print(2, "Invalid number of samples\n");
+        ::exit(1);
+      }
+      break;
+
+    case OPT_ALL_MODES:
+      gArgs.mAllModes = true;
       break;
 
     case '?':
     default:
       // getopt_long should have output an error message.
-      std::cout << std::endl;
+      print(1, "\n");
       usage(1);
     }
   }
 
   // runexcl needs at least one non-option argument to use as the command to
-  // run.
-  if (optind >= argc)
+  // run, unless it is asked to perform a measurement instead, or doesn't run
+  // a command at all.
+  bool measure = gArgs.mFreqLatencySamples || gArgs.mProbeMemory ||
+                 gArgs.mMeasureTopology;
+  bool command = !gArgs.mCompact && gArgs.mSessionCreate.empty() &&
+                 gArgs.mSessionClose.empty();
+  if ((optind < argc) ? !command
+                      : (command && !measure && gArgs.mAB.empty()))
+    usage(1);
+
+  // --all-modes only applies to the frequency transition latency.
+  if (gArgs.mAllModes && !gArgs.mFreqLatencySamples)
+    usage(1);
+
+  // --ab and --warmup-runs only make sense for repeated runs of a command.
+  // The filler's CPU time would count as the command's.
+  if (!gArgs.mRepeat ? !gArgs.mAB.empty() || gArgs.mWarmupRuns
+                     : !command || measure || !gArgs.mFiller.empty())
+    usage(1);
+
+  // Either a cpu set or the number of CPUs must be specified, unless
+  // compacting, which works on the existing partitions only, or using an
+  // existing session.
+  bool existing = gArgs.mCompact || !gArgs.mSession.empty() ||
+                  !gArgs.mSessionClose.empty();
+  if (existing ? !gArgs.mSet.empty() || gArgs.mCount
+               : (gArgs.mSet.empty() == !gArgs.mCount))
+    usage(1);
+
+  // The settings of a session are made when it is created.
+  if (!gArgs.mSession.empty() &&
+      ((gArgs.mFrequency != 0.0) || gArgs.mIsolate ||
+       !gArgs.mNetQueues.empty() || gArgs.mBoost || gArgs.mReserve ||
+       !gArgs.mFiller.empty() || !gArgs.mClass.empty())) {
+    print(2, "Settings for a session are given with --session-create.\n");
+    return 1;
+  }
+  if (!gArgs.mSessionCreate.empty() && gArgs.mReserve)
     usage(1);
 
-  // For now, a cpu set must be specified
-  if (gArgs.mSet.empty())
+  // A reservation needs a window. --for alone tells runexcl how long the
+  // command is expected to run, which lets it use CPUs reserved for later.
+  if (gArgs.mReserve ? (!gArgs.mAt || !gArgs.mFor) : gArgs.mAt)
     usage(1);
+  time_t end = gArgs.mFor ? (gArgs.mReserve ? gArgs.mAt : ::time(nullptr)) +
+                                (time_t)gArgs.mFor
+                          : 0;
+  if (gArgs.mReserve && (end <= ::time(nullptr))) {
+    print(2, "The reservation window has already passed.\n");
+    return 1;
+  }
 
   // Get the pointer to the first of the command line to execute on the slice.
   char** run_argv = &argv[optind];
@@ -233,108 +1219,337 @@ int main(int argc, char** argv)
   sigaddset(&nsignals, SIGTERM);
   sigaddset(&nsignals, SIGHUP);
   if (::sigprocmask(SIG_SETMASK, &nsignals, &osignals)) {
-    std::cerr << "Setting signal mask failed: " << strerror(errno)
-              << std::endl;
+    print(2, "Setting signal mask failed: %s\n", strerror(errno));
     return 1;
   }
 
+  // The exit status of the command, which becomes runexcl's.
+  int code = 0;
+
   try {
-    // Make sure runexcl.slice is set up and determine the set of CPUs available.
-    CPUSet available = CPUCGroup::setupSlice();
+    if (!gArgs.mSessionClose.empty())
+      return close_session(gArgs.mSessionClose);
 
-    // Check if the requested CPUs are available
-    CPUSet set = available & gArgs.mSet;
-    if (set != gArgs.mSet) {
-      std::cerr << "cpuset must be in '" << available.to_string() << "'."
-                << std::endl;
+    // Read the configuration and determine the pool to use. The pool provides
+    // the defaults for options not given on the command line.
+    Config config;
+    config.read();
+    Pool pool = config.pool(gArgs.mPool);
+
+    // Switching the cpufreq driver's mode changes the frequency scaling of
+    // all CPUs, including other users' partitions, so only root may do it.
+    if (gArgs.mAllModes && ::getuid()) {
+      print(2, "Only root may measure all cpufreq driver modes.\n");
       return 1;
     }
 
-    CPUCGroup group(set);
-    if (gArgs.mIsolate)
-      group.isolate(true);
+    // Compacting moves other users' partitions, so only root may do it.
+    if (gArgs.mCompact) {
+      if (::getuid()) {
+        print(2, "Only root may compact partitions.\n");
+        return 1;
+      }
+      CPUTopology topology;
+      for (int i = 0; i < gArgs.mCompact; ++i) {
+        Move move = CPUCGroup::compact(pool, topology, gArgs.mMigrateMemory);
+        if (move.empty())
+          break;
+        print(1, "Moved partition from CPUs '%s' to '%s'.\n",
+              move.mFrom.to_string().c_str(), move.mTo.to_string().c_str());
+      }
+      return 0;
+    }
 
-    CPUGovernor governor;
-    if (gArgs.mFrequency != 0.0)
-      governor.set_frequency(set, gArgs.mFrequency);
+    if (gArgs.mSession.empty()) {
+      if (0.0 == gArgs.mFrequency)
+        gArgs.mFrequency = pool.mFrequency;
+      if (pool.mIsolate)
+        gArgs.mIsolate = true;
+    }
 
-    // Clone the child process directly into the cgroup. Additionally add the
-    // CLONE_VFORK flag to the clone system call because the parent process
-    // doesn't need to run until the child process calls execve (actually, it
-    // only needs to run after the child process terminates).
-    pid_t child = group.clone(CLONE_VFORK);
-    if (-1 == child) {
-      throw std::system_error(errno, std::system_category(),
-                              "clone3() failed:");
+    pid_t holder;
+    if (!gArgs.mSessionCreate.empty() &&
+        !CPUCGroup::find_session(gArgs.mSessionCreate, ::getuid(), holder)
+             .empty()) {
+      print(2, "Session '%s' already exists.\n", gArgs.mSessionCreate.c_str());
+      return 1;
     }
-    else if (!child) {
-      try {
-        // Set the main thread's CPU affinity mask.
-        set.setaffinity();
-
-        // Drop root privileges. Since runexcl will run as a SUID binary, it
-        // should not be necessary to fiddle with the supplementary groups, as
-        // those should be set correctly for the user running the binary - we
-        // only need to drop the primary group in case the group S-bit is also
-        // set on the binary.
-        if (::setgid(getgid()) || ::setuid(getuid()))
-          throw std::system_error(errno, std::system_category(),
-                                  "Could not drop privileges:");
-
-        // Close all open file descriptors except stdin, stdout, and stderr.
-        // This is necessary because we cannot be sure all file descriptors
-        // where opened with the FD_CLOEXEC flag. Note that we don't use
-        // std::filesystem::directory_iterator here because getting at the
-        // necessary information is more convenient using the POSIX APIs
-        // directly.        
-        DIR* dir = ::opendir("/proc/self/fd");
-        if (dir) {
-          int dfd = ::dirfd(dir);
-          for (struct dirent* entry; entry = ::readdir(dir);) {
-            // /proc/self/fd should only contain '.', '..', or names consisting
-            // only of digits. strtol will return 0 for '.' and '..', so we
-            // don't need to check for invalid characters in strtol.
-            int fd = ::strtol(entry->d_name, nullptr, 10);
-            if ((fd > 2) && (fd != dfd))
-              ::close(fd);
+
+    // Determine the limits for the user. Measuring the frequency transition
+    // latency switches between the lowest and highest frequency.
+    Quota quota(config, ::getuid(), groups());
+    quota.check_frequency(gArgs.mFrequency);
+    if (gArgs.mFreqLatencySamples) {
+      quota.check_frequency(FREQUENCY_MAX);
+      quota.check_frequency(FREQUENCY_MIN);
+    }
+    if (!gArgs.mNetQueues.empty())
+      quota.check_net_queues();
+    if (gArgs.mBoost)
+      quota.check_boost();
+
+    // Make sure the pool's slice is set up and determine the set of CPUs
+    // available.
+    CPUSet available = CPUCGroup::setupSlice(pool);
+
+    // Check if the requested CPUs are available
+    if ((available & gArgs.mSet) != gArgs.mSet) {
+      print(2, "cpuset must be in '%s'.\n", available.to_string().c_str());
+      return 1;
+    }
+
+    // Read the CPU topology now, as the child should do as little work as
+    // possible before calling execvp.
+    CPUTopology topology;
+
+    // Create the partition, either for the requested CPUs, or for CPUs
+    // selected according to the pool's allocation policy.
+    std::unique_ptr<CPUCGroup> partition;
+    Reservation                reservation;
+    if (!gArgs.mSession.empty())
+      partition.reset(new CPUCGroup(gArgs.mSession));
+    else if (!gArgs.mReserve) {
+      partition.reset(gArgs.mSet.empty()
+                          ? new CPUCGroup(pool, quota, gArgs.mCount, topology,
+                                          gArgs.mIsolate, end, gArgs.mClass)
+                          : new CPUCGroup(pool, quota, gArgs.mSet,
+                                          gArgs.mIsolate, end, gArgs.mClass));
+    }
+    else {
+      reservation =
+          CPUCGroup::reserve(pool, quota, gArgs.mSet, gArgs.mCount, topology,
+                             gArgs.mIsolate, gArgs.mAt, end);
+      print(2, "Reserved CPUs '%s' for %s.\n",
+            reservation.mCPUs.to_string().c_str(),
+            reservation.window().c_str());
+
+      // Set up the partition ahead of the window. New partitions can't take
+      // the reserved CPUs anymore, but partitions that existed before the
+      // reservation was made may still hold them, so keep trying until they
+      // are gone or the window has ended.
+      if (!wait_until(reservation.mStart - RESERVATION_LEAD, nsignals))
+        return 1;
+      std::string waiting;
+      while (!partition) {
+        try {
+          partition.reset(new CPUCGroup(pool, quota, reservation.mCPUs,
+                                        gArgs.mIsolate, reservation.mEnd,
+                                        gArgs.mClass));
+        }
+        catch (std::exception const& e) {
+          if (::time(nullptr) + 1 >= reservation.mEnd)
+            throw;
+          if (waiting != e.what()) {
+            waiting = e.what();
+            print(2, "Waiting for the reserved CPUs: %s\n", e.what());
           }
-          ::closedir(dir);
+          if (!wait_until(::time(nullptr) + 1, nsignals))
+            return 1;
         }
+      }
+    }
+    CPUCGroup& group = *partition;
+    CPUSet     set   = group.cpus();
+
+    // Start loading the command and its input files into the page cache while
+    // we set up the partition.
+    Prewarm prewarm;
+    if (gArgs.mPrewarm && run_argv[0]) {
+      prewarm.add_executable(run_argv[0]);
+      for (std::string const& file : gArgs.mPrewarmFiles)
+        prewarm.add(file);
+      prewarm.start(topology.nodes(set));
+    }
 
-        /*
-         * The child inherits the signal mask from the parent, so we restore
-         * the signal mask the parent had before we blocked any signals above.
-         */
-        if (::sigprocmask(SIG_SETMASK, &osignals, NULL))
-          throw std::system_error(errno, std::system_category(),
-                                  "sigprocmask");
+    if (gArgs.mBoost)
+      group.boost();
 
-        if (execvp(run_argv[0], run_argv))
-          throw std::system_error(errno, std::system_category(), run_argv[0]);
+    // A core scheduling cookie keeps other tasks off the siblings of the
+    // command's CPUs, so siblings outside the partition would be forced idle
+    // while the command runs.
+    if (gArgs.mCoreSched) {
+      CPUSet shared;
+      for (CPUSet const& core : topology.cores(set)) {
+        if (topology.core(core.first()) != core)
+          shared |= core;
       }
-      catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
-        // Call _exit because we don't want to call the cpugroup destructor in
-        // the child.
-        _exit(1);
+      if (!shared.empty())
+        print(2,
+              "Warning: CPU(s) '%s' share their core with CPUs outside the "
+              "partition.\n",
+              shared.to_string().c_str());
+    }
+
+    // The CPUs isolated at boot are quieter than anything isolate() can
+    // achieve, so point out explicitly requested CPUs that are not among
+    // them, and how many of the partition's CPUs can stop the tick.
+    if (gArgs.mIsolate) {
+      CPUSet quiet   = topology.boot_isolated();
+      CPUSet outside = set ^ (set & quiet);
+      if (!gArgs.mSet.empty() && !quiet.empty() && !outside.empty())
+        print(2,
+              "Warning: CPU(s) '%s' were not isolated at boot; '%s' were.\n",
+              outside.to_string().c_str(), quiet.to_string().c_str());
+      if (!topology.nohz_full().empty())
+        print(2, "Tick stopped on %d of %d CPU(s) (nohz_full).\n",
+              (set & topology.nohz_full()).count(), set.count());
+    }
+
+    // Measure the frequency transition latency from inside the partition, so
+    // that nothing else runs on the CPU we measure. Each mode of the driver
+    // is measured separately, as e.g. amd_pstate behaves very differently in
+    // passive, guided, and active mode.
+    if (gArgs.mFreqLatencySamples) {
+      int                      cpu   = set.first();
+      std::vector<std::string> modes = gArgs.mAllModes
+                                           ? CPUGovernor::modes()
+                                           : std::vector<std::string>{
+                                                 CPUGovernor::mode()};
+      return group.run([&]() {
+        CPUSet pin;
+        pin.set(cpu);
+        pin.setaffinity();
+        for (std::string const& mode : modes) {
+          // Check before every switch, as partitions may come and go.
+          if (gArgs.mAllModes && !group.alone()) {
+            print(2, "Other partitions exist, not switching the cpufreq "
+                     "driver's mode.\n");
+            return 1;
+          }
+          std::ostringstream out;
+          CPUGovernor::measure_transition_latency(
+              cpu, gArgs.mFreqLatencySamples, mode, out);
+          print(1, out.str());
+        }
+        return 0;
+      });
+    }
+
+    // Settings a previous partition left on our CPUs are taken over if we
+    // set the frequency, and restored otherwise.
+    CPUGovernor governor(pool.mFrequencyGrace);
+    if (gArgs.mFrequency != 0.0)
+      governor.set_frequency(set, gArgs.mFrequency);
+    else if (gArgs.mSession.empty())
+      CPUGovernor::restore(set);
+
+    // Measure the latency between the cores from inside the partition. Only
+    // root may change the topology cache, as it affects the placement of all
+    // partitions.
+    if (gArgs.mMeasureTopology) {
+      return group.run([&]() {
+        CoreLatency latency;
+        latency.measure(set, topology);
+        std::string out = latency.to_string() + "Clusters:";
+        for (CPUSet const& cluster : latency.clusters(topology))
+          out += ' ' + cluster.to_string();
+        print(1, out + '\n');
+        if (!::getuid()) {
+          latency.save(TOPOLOGY_CACHE, topology);
+          print(1, "Saved to " TOPOLOGY_CACHE ".\n");
+        }
+        return 0;
+      });
+    }
+
+    // Probe the memory from inside the partition, at the frequency the
+    // command would run at.
+    if (gArgs.mProbeMemory) {
+      return group.run([&]() {
+        std::ostringstream out;
+        MemoryProbe::probe(set, topology, out);
+        print(1, out.str());
+        return 0;
+      });
+    }
+
+    // Steer network processing onto the partition. The original settings are
+    // restored when netqueues goes out of scope, i.e. after wait_empty().
+    NetQueues netqueues(group, gArgs.mNetIRQs);
+    for (std::string const& spec : gArgs.mNetQueues)
+      netqueues.add(spec);
+
+    // Let --compact move the partition if nothing here depends on its CPUs.
+    // compact() doesn't know the anti-affinity rules, so it could move a
+    // partition with a class next to one of the same class.
+    if (gArgs.mSession.empty() && (0.0 == gArgs.mFrequency) &&
+        !gArgs.mIsolate && gArgs.mClass.empty() && gArgs.mNetQueues.empty() &&
+        gArgs.mScratchSize.empty() && gArgs.mFiller.empty() &&
+        (0.0 == gArgs.mOversubscription))
+      group.set_movable();
+
+    prewarm.wait();
+
+    // Run the command when the window starts, taking the warm-up into
+    // account.
+    if (gArgs.mReserve &&
+        !wait_until(reservation.mStart - (gArgs.mWarmup + 999) / 1000,
+                    nsignals))
+      return 1;
+
+    // Hand the partition and its settings over to a background process that
+    // holds them until the session is closed, or has been idle for too long.
+    if (!gArgs.mSessionCreate.empty()) {
+      holder = daemonize();
+      if (-1 == holder)
+        throw std::system_error(errno, std::system_category(), "fork");
+      else if (holder) {
+        try {
+          group.set_session(gArgs.mSessionCreate, holder);
+        }
+        catch (...) {
+          ::kill(holder, SIGTERM);
+          throw;
+        }
+        print(1, "Created session '%s' on CPUs '%s'.\n",
+              gArgs.mSessionCreate.c_str(), set.to_string().c_str());
+        _exit(0);
       }
-    } // Child process
-    else {
-      // Wait until the child terminates.
-      int status;
-      if (-1 == waitpid(child, &status, 0))
-        throw std::system_error(errno, std::system_category(),
-                                "waitpid() failed:");
 
-      // And wait until the cgroup is empty. This is necessary in case the child
-      // forked its own children that outlived it.
+      hold_session(group, gArgs.mIdleTimeout, nsignals);
+      group.wait_empty();
+      if (governor.release() > 0.0)
+        restore_later();
+      return 0;
+    }
+
+    // Warm up the CPUs. This happens in a separate process inside the
+    // partition, as the CPUs are not available to runexcl itself.
+    if (gArgs.mWarmup) {
+      group.run([&]() {
+        return warm_up(set, governor, gArgs.mWarmup / 1000.0);
+      });
+    }
+
+    // Run the command and wait until it terminates, or with --repeat, run
+    // the benchmark.
+    if (gArgs.mRepeat)
+      code = run_benchmark(group, set, topology, run_argv, osignals);
+    else
+      code = run_command(group, set, topology, run_argv, osignals);
+
+    // With --detach-cleanup, report the exit status now and leave the
+    // teardown to a background process, which keeps the signal mask so
+    // that it cannot be interrupted halfway. If the process cannot be
+    // created, clean up as usual.
+    if (gArgs.mDetachCleanup && (daemonize() > 0))
+      _exit(code);
+
+    // And wait until the cgroup is empty. This is necessary in case the child
+    // forked its own children that outlived it. In a session, that is left
+    // to the process holding it.
+    if (gArgs.mSession.empty())
       group.wait_empty();
-    } // Parent process
+
+    // Keep the frequency settings for the grace period, in case the next
+    // partition wants the same ones.
+    if (governor.release() > 0.0)
+      restore_later();
   }
-  catch (std::system_error& e) {
-    std::cerr << e.what() << std::endl;
+  catch (std::exception& e) {
+    print(2, "%s\n", e.what());
     return 1;
   }
 
-  return 0;
+  return code;
 }
\ No newline at end of file
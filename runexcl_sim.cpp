@@ -0,0 +1,453 @@
+// runexcl_sim.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+// runexcl_sim replays a trace of jobs against a synthetic CPU topology to
+// compare how well the allocation policies pack jobs, without touching any
+// cgroups. Each line of the trace describes one job:
+//
+//   <arrival> <width> <duration> [llc|node]
+//
+// where arrival and duration are in seconds and width is the number of CPUs.
+// The optional constraint requires all CPUs of the job to share a last level
+// cache or a NUMA node. Everything following a '#' is a comment.
+
+#include "CPUAllocator.hpp"
+#include "CPUSet.hpp"
+#include "CPUTopology.hpp"
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class Constraint
+{
+  None,
+  LLC,
+  Node
+};
+
+struct Job
+{
+  double     mArrival;
+  int        mWidth;
+  double     mDuration;
+  Constraint mConstraint;
+};
+
+// Results of replaying a trace with one policy.
+struct Result
+{
+  std::vector<double> mWaits;
+  double              mBusy     = 0.0;
+  double              mEnd      = 0.0;
+  long                mSplit    = 0;
+  long                mRejected = 0;
+  long                mEvents   = 0;
+  double              mElapsed  = 0.0;
+};
+
+// A running job, ordered by the time it ends.
+struct Running
+{
+  double mEnd;
+  CPUSet mSet;
+
+  bool operator<(Running const& rhs) const
+  {
+    return mEnd > rhs.mEnd;
+  }
+};
+
+static std::vector<Job> read_trace(std::istream& in)
+{
+  std::vector<Job> jobs;
+  std::string      line;
+  int              lineno = 0;
+  while (std::getline(in, line)) {
+    lineno += 1;
+    std::istringstream fields(line.substr(0, line.find('#')));
+    Job                job = {0.0, 0, 0.0, Constraint::None};
+    std::string        constraint;
+    if (!(fields >> job.mArrival))
+      continue;
+    if (!(fields >> job.mWidth >> job.mDuration) || (job.mWidth <= 0) ||
+        (job.mDuration < 0.0))
+      throw std::runtime_error("line " + std::to_string(lineno) +
+                               ": expected '<arrival> <width> <duration>'");
+    if (fields >> constraint) {
+      if ("llc" == constraint)
+        job.mConstraint = Constraint::LLC;
+      else if ("node" == constraint)
+        job.mConstraint = Constraint::Node;
+      else
+        throw std::runtime_error("line " + std::to_string(lineno) +
+                                 ": unknown constraint '" + constraint + "'");
+    }
+    jobs.push_back(job);
+  }
+
+  std::stable_sort(jobs.begin(), jobs.end(), [](Job const& a, Job const& b) {
+    return a.mArrival < b.mArrival;
+  });
+  return jobs;
+}
+
+// Generate count jobs with exponentially distributed interarrival times and
+// durations, and power-of-two widths up to twice llc_size, so that the
+// expected load on cpus CPUs is load. A fraction constrained of the jobs must
+// stay on one last level cache if they fit into one, or else on one node.
+static std::vector<Job> generate_trace(long count, int cpus, int llc_size,
+                                       double load, double constrained)
+{
+  int                                   max_log = std::ilogb(2 * llc_size);
+  std::mt19937_64                       rng(1);
+  std::uniform_int_distribution<int>    log_width(0, max_log);
+  std::exponential_distribution<double> duration(1.0 / 60.0);
+  std::bernoulli_distribution           constrain(constrained);
+  double                                mean_width = 0.0;
+  for (int i = 0; i <= max_log; ++i)
+    mean_width += (1 << i);
+  mean_width /= max_log + 1;
+  std::exponential_distribution<double> interarrival(cpus * load /
+                                                     (mean_width * 60.0));
+
+  std::vector<Job> jobs;
+  double           now = 0.0;
+  jobs.reserve(count);
+  for (long i = 0; i < count; ++i) {
+    now += interarrival(rng);
+    int        width      = 1 << log_width(rng);
+    Constraint constraint = Constraint::None;
+    if (constrain(rng))
+      constraint = (width <= llc_size) ? Constraint::LLC : Constraint::Node;
+    jobs.push_back({now, width, duration(rng), constraint});
+  }
+  return jobs;
+}
+
+// Replay jobs in first come, first served order.
+static Result simulate(CPUTopology const& topology, AllocationPolicy policy,
+                       std::vector<Job> const& jobs)
+{
+  CPUAllocator allocator(topology, policy);
+  Result       result;
+  CPUSet       free = topology.cpus();
+  int          cpus = free.count();
+
+  // The domains jobs with constraints are confined to, and the number of
+  // free CPUs in each, so that placing a job needs no set operations unless
+  // it fits.
+  std::vector<CPUSet> llc_domains, node_domains;
+  for (int cpu : topology.order()) {
+    if (topology[cpu].mLLC == cpu)
+      llc_domains.push_back(topology.llc(cpu));
+  }
+  CPUSet nodes = topology.nodes(topology.cpus());
+  for (int node = nodes.first(); node >= 0; node = nodes.next(node))
+    node_domains.push_back(topology.node(node));
+
+  // Index of the domains of each CPU.
+  std::vector<int> llc_of(free.max_cpus()), node_of(free.max_cpus());
+  for (size_t i = 0; i < llc_domains.size(); ++i) {
+    CPUSet const& domain = llc_domains[i];
+    for (int cpu = domain.first(); cpu >= 0; cpu = domain.next(cpu))
+      llc_of[cpu] = i;
+  }
+  for (size_t i = 0; i < node_domains.size(); ++i) {
+    CPUSet const& domain = node_domains[i];
+    for (int cpu = domain.first(); cpu >= 0; cpu = domain.next(cpu))
+      node_of[cpu] = i;
+  }
+
+  std::vector<int> llc_free, node_free;
+  for (CPUSet const& domain : llc_domains)
+    llc_free.push_back(domain.count());
+  for (CPUSet const& domain : node_domains)
+    node_free.push_back(domain.count());
+  std::vector<long> llc_seen(llc_domains.size(), -1);
+  long              updates    = 0;
+  int               free_count = cpus;
+  int               llc_size   = llc_free.front();
+
+  // Account for the CPUs in set becoming free (n = 1) or busy (n = -1), and
+  // return the number of last level caches set spans.
+  auto update = [&](CPUSet const& set, int n) {
+    int spanned = 0;
+    updates += 1;
+    for (int cpu = set.first(); cpu >= 0; cpu = set.next(cpu)) {
+      llc_free[llc_of[cpu]] += n;
+      node_free[node_of[cpu]] += n;
+      free_count += n;
+      spanned += (llc_seen[llc_of[cpu]] != updates);
+      llc_seen[llc_of[cpu]] = updates;
+    }
+    return spanned;
+  };
+
+  // Place a job on the free CPUs, returning an empty set if it doesn't fit.
+  // Jobs with constraints use the domain with the fewest free CPUs that fits.
+  auto place = [&](Job const& job) {
+    if (job.mWidth > free_count)
+      return CPUSet();
+    if (Constraint::None == job.mConstraint)
+      return allocator.allocate(free, job.mWidth);
+
+    bool   llc     = (Constraint::LLC == job.mConstraint);
+    auto&  domains = llc ? llc_domains : node_domains;
+    auto&  counts  = llc ? llc_free : node_free;
+    size_t best    = domains.size();
+    for (size_t i = 0; i < domains.size(); ++i) {
+      if ((counts[i] >= job.mWidth) &&
+          ((best == domains.size()) || (counts[i] < counts[best])))
+        best = i;
+    }
+    if (best == domains.size())
+      return CPUSet();
+    return allocator.allocate(domains[best] & free, job.mWidth);
+  };
+
+  auto fits = [&](Job const& job) {
+    if (Constraint::None == job.mConstraint)
+      return job.mWidth <= cpus;
+    auto& domains = (Constraint::LLC == job.mConstraint) ? llc_domains
+                                                         : node_domains;
+    for (CPUSet const& domain : domains) {
+      if (domain.count() >= job.mWidth)
+        return true;
+    }
+    return false;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::priority_queue<Running> running;
+  std::deque<size_t>           queue;
+  size_t                       next = 0;
+  result.mWaits.reserve(jobs.size());
+  while ((next < jobs.size()) || !running.empty()) {
+    double now;
+    if (!running.empty() && ((next == jobs.size()) ||
+                             (running.top().mEnd <= jobs[next].mArrival))) {
+      now = running.top().mEnd;
+      free |= running.top().mSet;
+      update(running.top().mSet, 1);
+      running.pop();
+    }
+    else {
+      now = jobs[next].mArrival;
+      if (fits(jobs[next]))
+        queue.push_back(next);
+      else
+        result.mRejected += 1;
+      next += 1;
+    }
+    result.mEvents += 1;
+
+    // Start as many of the queued jobs as possible, in order.
+    while (!queue.empty()) {
+      Job const& job = jobs[queue.front()];
+      CPUSet     set = place(job);
+      if (set.empty())
+        break;
+      queue.pop_front();
+
+      free ^= set;
+      result.mWaits.push_back(now - job.mArrival);
+      result.mBusy += job.mWidth * job.mDuration;
+      if (update(set, -1) > (job.mWidth + llc_size - 1) / llc_size)
+        result.mSplit += 1;
+      running.push({now + job.mDuration, std::move(set)});
+    }
+    result.mEnd = now;
+  }
+
+  result.mElapsed = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  return result;
+}
+
+static void report(std::ostream& out, char const* name, Result& result,
+                   int cpus)
+{
+  std::vector<double>& waits = result.mWaits;
+  std::sort(waits.begin(), waits.end());
+  auto percentile = [&](double p) {
+    return waits.empty() ? 0.0 : waits[(size_t)(p * (waits.size() - 1))];
+  };
+
+  out << std::left << std::setw(8) << name << std::right << std::fixed
+      << std::setw(10) << waits.size() << std::setprecision(3)
+      << std::setw(8)
+      << (result.mEnd > 0.0 ? result.mBusy / (cpus * result.mEnd) : 0.0)
+      << std::setprecision(1) << std::setw(10) << percentile(0.5)
+      << std::setw(10) << percentile(0.9) << std::setw(10)
+      << percentile(0.99) << std::setw(10)
+      << (waits.empty() ? 0.0 : waits.back()) << std::setw(8)
+      << result.mSplit << std::setw(8) << result.mRejected << std::setw(12)
+      << std::setprecision(0)
+      << (result.mElapsed > 0.0 ? result.mEvents / result.mElapsed : 0.0)
+      << std::endl;
+}
+
+[[noreturn]] static void usage(int exit_code)
+{
+  std::cerr
+      << "Usage: runexcl_sim [OPTION]... [TRACE]\n"
+         "Replay a trace of jobs (or standard input) for each allocation "
+         "policy.\n"
+         "  -t, --topology <n>x<l>x<c>x<t>  NUMA nodes, last level caches per "
+         "node,\n"
+         "                                  cores per cache, and threads per "
+         "core\n"
+         "                                  (default 2x4x8x2).\n"
+         "  -p, --policy <policy>           Only simulate linear, compact, or "
+         "spread.\n"
+         "  -g, --generate <n>              Generate a trace of n jobs "
+         "instead.\n"
+         "  -l, --load <load>               Offered load of the generated "
+         "trace\n"
+         "                                  (default 0.9).\n"
+         "  -c, --constrained <fraction>    Fraction of the generated jobs "
+         "confined\n"
+         "                                  to one cache or node (default "
+         "0.25).\n";
+  exit(exit_code);
+}
+
+static struct option sLongOptions[] = {
+    {"topology", required_argument, nullptr, 't'},
+    {"policy", required_argument, nullptr, 'p'},
+    {"generate", required_argument, nullptr, 'g'},
+    {"load", required_argument, nullptr, 'l'},
+    {"constrained", required_argument, nullptr, 'c'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+int main(int argc, char** argv)
+{
+  int    nodes = 2, llcs_per_node = 4, cores_per_llc = 8, threads = 2;
+  long   generate    = 0;
+  double load        = 0.9;
+  double constrained = 0.25;
+  std::vector<char const*> policies = {"linear", "compact", "spread"};
+
+  int c, index;
+  while (-1 !=
+         (c = getopt_long(argc, argv, "t:p:g:l:c:h", sLongOptions, &index))) {
+    switch (c) {
+    case 't':
+      if ((4 != sscanf(optarg, "%dx%dx%dx%d", &nodes, &llcs_per_node,
+                       &cores_per_llc, &threads)) ||
+          (nodes <= 0) || (llcs_per_node <= 0) || (cores_per_llc <= 0) ||
+          (threads <= 0)) {
+        std::cerr << "Invalid topology '" << optarg << "'" << std::endl;
+        return 1;
+      }
+      break;
+
+    case 'p':
+      try {
+        CPUAllocator::policy(optarg);
+      }
+      catch (std::invalid_argument const& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+      }
+      policies = {optarg};
+      break;
+
+    case 'g':
+      generate = ::atol(optarg);
+      break;
+
+    case 'l':
+      load = ::atof(optarg);
+      break;
+
+    case 'c':
+      constrained = ::atof(optarg);
+      if ((constrained < 0.0) || (constrained > 1.0)) {
+        std::cerr << "Invalid fraction '" << optarg << "'" << std::endl;
+        return 1;
+      }
+      break;
+
+    case 'h':
+      usage(0);
+
+    default:
+      usage(1);
+    }
+  }
+  if (argc > optind + 1)
+    usage(1);
+
+  try {
+    CPUTopology topology(nodes, llcs_per_node, cores_per_llc, threads);
+    int         cpus = topology.cpus().count();
+
+    std::vector<Job> jobs;
+    if (generate > 0) {
+      jobs = generate_trace(generate, cpus, cores_per_llc * threads, load,
+                            constrained);
+    }
+    else if (argc > optind) {
+      std::ifstream in(argv[optind]);
+      if (!in)
+        throw std::runtime_error("Cannot open '" + std::string(argv[optind]) +
+                                 "'");
+      jobs = read_trace(in);
+    }
+    else {
+      jobs = read_trace(std::cin);
+    }
+
+    std::cout << "policy        jobs    util  wait-p50  wait-p90  wait-p99"
+                 "  wait-max   split  reject    events/s"
+              << std::endl;
+    for (char const* name : policies) {
+      Result result = simulate(topology, CPUAllocator::policy(name), jobs);
+      report(std::cout, name, result, cpus);
+    }
+  }
+  catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+// runexcl_startup.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+// runexcl_startup measures how long runexcl takes to start a command:
+//
+//   exec-to-main:  from fork() until main() of the probe (runexcl_startup
+//                  itself) runs, without runexcl. This is the baseline any
+//                  command pays.
+//   runexcl:       from fork() until runexcl --version has exited, i.e.
+//                  runexcl's dynamic linking and static initialization.
+//   exec-to-child: from fork() until main() of the probe runs when started
+//                  through runexcl on the given CPUs, i.e. the whole launch
+//                  path including setting up the partition.
+//
+// The probe reports the time it reached main() on its standard output.
+// CLOCK_MONOTONIC is system-wide, so the times can be compared directly.
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static long long now()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Run argv and return the time from fork() until the probe reached main() if
+// probe is true, or until argv exited otherwise. Returns -1 on failure.
+static long long run(std::vector<char const*> const& argv, bool probe)
+{
+  int fds[2];
+  if (::pipe(fds))
+    return -1;
+
+  long long start = now();
+  pid_t     child = ::fork();
+  if (-1 == child) {
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return -1;
+  }
+  if (!child) {
+    ::dup2(fds[1], 1);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    ::execv(argv[0], const_cast<char* const*>(argv.data()));
+    _exit(127);
+  }
+  ::close(fds[1]);
+
+  char    buffer[64] = {0};
+  ssize_t n          = 0;
+  for (ssize_t r; (r = ::read(fds[0], buffer + n, sizeof(buffer) - n - 1));) {
+    if (r < 0) {
+      if (EINTR == errno)
+        continue;
+      break;
+    }
+    n += r;
+  }
+  ::close(fds[0]);
+
+  int status;
+  while ((-1 == ::waitpid(child, &status, 0)) && (EINTR == errno))
+    ;
+  long long end = now();
+  if (!WIFEXITED(status) || WEXITSTATUS(status))
+    return -1;
+
+  return probe ? ::atoll(buffer) - start : end - start;
+}
+
+static void report(char const* label, std::vector<long long>& times)
+{
+  if (times.empty()) {
+    ::printf("%-14s failed\n", label);
+    return;
+  }
+  std::sort(times.begin(), times.end());
+  ::printf("%-14s %9.1f %9.1f %9.1f\n", label, times.front() / 1000.0,
+           times[times.size() / 2] / 1000.0,
+           times[times.size() * 9 / 10] / 1000.0);
+}
+
+[[noreturn]] static void usage(int exit_code)
+{
+  ::fprintf(stderr,
+            "Usage: runexcl_startup [-n <runs>] [-c <cpus>] [<runexcl>]\n"
+            "Measure the startup time of runexcl (default: runexcl next to\n"
+            "runexcl_startup). Without -c, only runexcl's own startup is\n"
+            "measured, as running a command requires root privileges.\n");
+  ::exit(exit_code);
+}
+
+int main(int argc, char** argv)
+{
+  if ((2 == argc) && !::strcmp(argv[1], "--probe")) {
+    ::printf("%lld\n", now());
+    return 0;
+  }
+
+  int         runs = 100;
+  char const* cpus = nullptr;
+  for (int c; -1 != (c = ::getopt(argc, argv, "n:c:h"));) {
+    switch (c) {
+    case 'n':
+      runs = ::atoi(optarg);
+      break;
+    case 'c':
+      cpus = optarg;
+      break;
+    case 'h':
+      usage(0);
+    default:
+      usage(1);
+    }
+  }
+  if ((runs <= 0) || (argc > optind + 1))
+    usage(1);
+
+  // The probe needs an absolute path, as runexcl runs it via execvp.
+  char self[4096];
+  ssize_t len = ::readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (len <= 0) {
+    ::perror("readlink");
+    return 1;
+  }
+  self[len] = '\0';
+
+  std::string runexcl;
+  if (argc > optind) {
+    runexcl = argv[optind];
+  }
+  else {
+    runexcl = self;
+    runexcl.replace(runexcl.rfind('/') + 1, std::string::npos, "runexcl");
+  }
+
+  std::vector<std::vector<char const*>> commands = {
+      {self, "--probe", nullptr},
+      {runexcl.c_str(), "--version", nullptr}};
+  std::vector<char const*> labels = {"exec-to-main", "runexcl"};
+  if (cpus) {
+    commands.push_back(
+        {runexcl.c_str(), "-c", cpus, self, "--probe", nullptr});
+    labels.push_back("exec-to-child");
+  }
+
+  ::printf("%-14s %9s %9s %9s (us)\n", "", "min", "median", "p90");
+  for (size_t i = 0; i < commands.size(); ++i) {
+    std::vector<long long> times;
+    for (int run_ = 0; run_ < runs; ++run_) {
+      long long t = run(commands[i], i != 1);
+      if (t >= 0)
+        times.push_back(t);
+    }
+    report(labels[i], times);
+  }
+  return 0;
+}
@@ -23,39 +23,132 @@
 //
 #include "sysfs.hpp"
 
-#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
 
-std::string sysfs_read(std::filesystem::path path)
+#include <cerrno>
+#include <system_error>
+
+// The helpers use plain POSIX I/O instead of file streams, as constructing a
+// stream (and its locale) costs more than the system calls themselves, and
+// runexcl accesses a lot of these files on its launch path.
+
+// Open path with flags, throwing a std::system_error describing what on
+// failure.
+static int open_file(std::filesystem::path const& path, int flags,
+                     char const* what)
 {
-  std::string   result;
-  std::ifstream file(path);
-  file >> result;
-  if (file.fail() && !file.eof())
+  int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+  if (-1 == fd)
     throw std::system_error(errno, std::system_category(),
-                            std::string("Could not read from \"" +
-                                        path.string() + "\""));
+                            std::string(what) + " \"" + path.string() +
+                                "\"");
+  return fd;
+}
+
+// Read everything from fd.
+static std::string read_all(int fd, std::filesystem::path const& path)
+{
+  std::string content;
+  char        buffer[4096];
+  ssize_t     n;
+  while (0 != (n = ::read(fd, buffer, sizeof(buffer)))) {
+    if (-1 == n) {
+      if (EINTR == errno)
+        continue;
+      int err = errno;
+      ::close(fd);
+      throw std::system_error(err, std::system_category(),
+                              "Could not read from \"" + path.string() +
+                                  "\"");
+    }
+    content.append(buffer, n);
+  }
+  return content;
+}
+
+// Read the first whitespace separated word from fd.
+static std::string read_word(int fd, std::filesystem::path const& path)
+{
+  std::string content = read_all(fd, path);
+  auto        first = content.find_first_not_of(" \t\n");
+  if (std::string::npos == first)
+    return std::string();
+  return content.substr(first,
+                        content.find_first_of(" \t\n", first) - first);
+}
+
+// Write value to fd with a single write(2) and close fd.
+static void write_value(int fd, std::filesystem::path const& path,
+                        std::string const& value)
+{
+  ssize_t n;
+  do {
+    n = ::write(fd, value.data(), value.size());
+  } while ((-1 == n) && (EINTR == errno));
+  int err = errno;
+  if (::close(fd) && (-1 != n)) {
+    err = errno;
+    n   = -1;
+  }
+  if (-1 == n)
+    throw std::system_error(err, std::system_category(),
+                            "Could not write to \"" + path.string() + "\"");
+}
+
+std::string sysfs_read(std::filesystem::path const& path)
+{
+  int         fd     = open_file(path, O_RDONLY, "Could not read from");
+  std::string result = read_word(fd, path);
+  ::close(fd);
   return result;
 }
 
-std::string sysfs_change(std::filesystem::path path, std::string value)
+std::string read_file(std::filesystem::path const& path)
 {
-  std::string  old;
-  std::fstream file(path);
-  file >> old;
-  if (file.fail() && !file.eof())
-    throw std::system_error(errno, std::system_category(),
-                            std::string("Could not read from \"" +
-                                        path.string() + "\""));
-
-  // Output should only follow input after calling one of the file positioning
-  // functions or flushing the stream.
-  file.seekp(0);
-  file << value;
-  file.close();
-  if (file.fail())
-    throw std::system_error(errno, std::system_category(),
-                            std::string("Could not write to \"" +
-                                        path.string() + "\""));
+  int         fd     = open_file(path, O_RDONLY, "Could not read from");
+  std::string result = read_all(fd, path);
+  ::close(fd);
+  return result;
+}
+
+std::vector<std::string> sysfs_read_words(std::filesystem::path const& path)
+{
+  int         fd      = open_file(path, O_RDONLY, "Could not read from");
+  std::string content = read_all(fd, path);
+  ::close(fd);
+
+  std::vector<std::string> words;
+  for (auto first = content.find_first_not_of(" \t\n");
+       std::string::npos != first;
+       first = content.find_first_not_of(" \t\n", first)) {
+    auto last = content.find_first_of(" \t\n", first);
+    words.push_back(content.substr(first, last - first));
+    first = last;
+  }
+  return words;
+}
+
+std::string sysfs_change(std::filesystem::path const& path,
+                         std::string const&           value)
+{
+  int         fd  = open_file(path, O_RDWR, "Could not read from");
+  std::string old = read_word(fd, path);
+
+  // sysfs attributes are always written from the start.
+  if (-1 == ::lseek(fd, 0, SEEK_SET)) {
+    int err = errno;
+    ::close(fd);
+    throw std::system_error(err, std::system_category(),
+                            "Could not write to \"" + path.string() + "\"");
+  }
+  write_value(fd, path, value);
 
   return old;
 }
+
+void sysfs_write(std::filesystem::path const& path, std::string const& value)
+{
+  write_value(open_file(path, O_WRONLY | O_TRUNC, "Could not write to"), path,
+              value);
+}
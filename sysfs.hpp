@@ -21,28 +21,41 @@
 // Eric Doenges
 // Eric.Doenges@gmx.net
 //
-#include <exception>
 #include <filesystem>
-#include <fstream>
 #include <string>
-#include <system_error>
+#include <type_traits>
+#include <vector>
 
 //! Read a string from the specified path.
 //! \param in path Path to sysfs file to read from
-//! \return std::string read from sysfs file with the '<<' operator.
-std::string sysfs_read(std::filesystem::path path);
+//! \return The first whitespace separated word of the file.
+std::string sysfs_read(std::filesystem::path const& path);
+
+//! Read the whole file at the specified path, e.g. a configuration file.
+std::string read_file(std::filesystem::path const& path);
+
+//! Read the whitespace separated words from the specified path (e.g. the
+//! CPUs in a cpufreq policy's affected_cpus).
+std::vector<std::string> sysfs_read_words(std::filesystem::path const& path);
 
 //! Read a string from the specified path, then write the new value to it.
-std::string sysfs_change(std::filesystem::path path, std::string value);
+std::string sysfs_change(std::filesystem::path const& path,
+                         std::string const&           value);
+
+//! Write value to the specified path with a single write(2), as sysfs expects.
+void sysfs_write(std::filesystem::path const& path, std::string const& value);
+
+inline void sysfs_write(std::filesystem::path const& path, char const* value)
+{
+  sysfs_write(path, std::string(value));
+}
 
+//! Write a number, or an object with a to_string() method (e.g. CPUSet).
 template<typename T>
-void sysfs_write(std::filesystem::path path, T const& value)
+void sysfs_write(std::filesystem::path const& path, T const& value)
 {
-  std::ofstream file(path);
-  file << value;
-  file.close();
-  if (file.fail())
-    throw std::system_error(errno, std::system_category(),
-                            std::string("Could not write to \"" +
-                                        path.string() + "\""));
+  if constexpr (std::is_arithmetic_v<T>)
+    sysfs_write(path, std::to_string(value));
+  else
+    sysfs_write(path, value.to_string());
 }
@@ -0,0 +1,85 @@
+// Benchmark_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Benchmark.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <stdexcept>
+
+TEST(BenchmarkCase, parse_cpu_stat)
+{
+  Benchmark::Sample sample;
+  Benchmark::parse_cpu_stat("usage_usec 3000000\n"
+                            "user_usec 2500000\n"
+                            "system_usec 500000\n"
+                            "nr_periods 0\n",
+                            sample);
+  EXPECT_EQ(sample.mUsage, 3.0);
+  EXPECT_EQ(sample.mUser, 2.5);
+  EXPECT_EQ(sample.mSystem, 0.5);
+  EXPECT_THROW(Benchmark::parse_cpu_stat("usage_usec 1\n", sample),
+               std::invalid_argument);
+}
+
+TEST(BenchmarkCase, summarize)
+{
+  Summary s = Benchmark::summarize({2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0});
+  EXPECT_EQ(s.mCount, 8u);
+  EXPECT_DOUBLE_EQ(s.mMean, 5.0);
+  EXPECT_DOUBLE_EQ(s.mMedian, 4.5);
+  EXPECT_NEAR(s.mStdDev, 2.138, 0.001);
+  EXPECT_NEAR(s.mCI, 2.365 * s.mStdDev / std::sqrt(8.0), 1e-9);
+  ASSERT_EQ(s.mOutliers.size(), 1u);
+  EXPECT_EQ(s.mOutliers[0], 7u);
+
+  s = Benchmark::summarize({1.0, 1.1, 0.9, 1.0, 1.2, 1.05});
+  EXPECT_TRUE(s.mOutliers.empty());
+
+  s = Benchmark::summarize({3.0});
+  EXPECT_EQ(s.mMedian, 3.0);
+  EXPECT_EQ(s.mCI, 0.0);
+}
+
+TEST(BenchmarkCase, compare)
+{
+  Comparison c =
+      Benchmark::compare({1.00, 1.01, 0.99, 1.00}, {1.10, 1.11, 1.09, 1.10});
+  EXPECT_NEAR(c.mDifference, 0.1, 1e-9);
+  EXPECT_TRUE(c.mSignificant);
+
+  c = Benchmark::compare({1.0, 1.2, 0.8, 1.0}, {1.1, 0.9, 1.3, 0.9});
+  EXPECT_FALSE(c.mSignificant);
+}
+
+TEST(BenchmarkCase, t_quantile)
+{
+  EXPECT_DOUBLE_EQ(Benchmark::t_quantile(1), 12.706);
+  EXPECT_DOUBLE_EQ(Benchmark::t_quantile(10), 2.228);
+  EXPECT_NEAR(Benchmark::t_quantile(10.5), 2.2145, 1e-9);
+  EXPECT_NEAR(Benchmark::t_quantile(30), 2.042, 0.001);
+  EXPECT_NEAR(Benchmark::t_quantile(120), 1.980, 0.001);
+  EXPECT_NEAR(Benchmark::t_quantile(1e9), 1.960, 0.001);
+}
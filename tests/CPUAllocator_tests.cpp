@@ -0,0 +1,127 @@
+// CPUAllocator_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "CPUAllocator.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+// One NUMA node with two last level caches of four cores with two hardware
+// threads each. CPUs 0-3 and 8-11 share the first cache, CPUs 4-7 and 12-15
+// the second one.
+static CPUTopology const sTopology(1, 2, 4, 2);
+
+TEST(CPUAllocatorCase, linear)
+{
+  CPUAllocator allocator(sTopology, AllocationPolicy::Linear);
+
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-15"), 3).to_string().c_str(),
+               "0-2");
+  EXPECT_STREQ(allocator.allocate(CPUSet("1,3,5-15"), 3).to_string().c_str(),
+               "1,3,5");
+}
+
+TEST(CPUAllocatorCase, compact)
+{
+  CPUAllocator allocator(sTopology, AllocationPolicy::Compact);
+
+  // Whole cores are preferred over single hardware threads.
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-15"), 2).to_string().c_str(),
+               "0,8");
+
+  // The cache with the fewest free CPUs that can hold the request is used.
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-7,12-15"), 4).to_string().c_str(),
+               "0-3");
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-7,10-15"), 4).to_string().c_str(),
+               "2-3,10-11");
+
+  // Partially used cores are filled up first.
+  EXPECT_STREQ(allocator.allocate(CPUSet("1-15"), 1).to_string().c_str(),
+               "8");
+
+  // Requests larger than a cache span as few caches as possible.
+  CPUSet set = allocator.allocate(CPUSet("0-15"), 10);
+  EXPECT_EQ(set.count(), 10);
+  EXPECT_EQ(sTopology.cores(set).size(), 5u);
+}
+
+TEST(CPUAllocatorCase, spread)
+{
+  CPUAllocator allocator(sTopology, AllocationPolicy::Spread);
+
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-15"), 4).to_string().c_str(),
+               "0,4,8,12");
+}
+
+TEST(CPUAllocatorCase, exhausted)
+{
+  CPUAllocator allocator(sTopology);
+
+  EXPECT_TRUE(allocator.allocate(CPUSet("0-3"), 5).empty());
+  // CPUs that are not online cannot be allocated.
+  EXPECT_TRUE(allocator.allocate(CPUSet("14-17"), 3).empty());
+}
+
+TEST(CPUAllocatorCase, policy)
+{
+  EXPECT_EQ(CPUAllocator::policy("linear"), AllocationPolicy::Linear);
+  EXPECT_EQ(CPUAllocator::policy("compact"), AllocationPolicy::Compact);
+  EXPECT_EQ(CPUAllocator::policy("spread"), AllocationPolicy::Spread);
+  EXPECT_THROW(CPUAllocator::policy("random"), std::invalid_argument);
+}
+
+TEST(CPUAllocatorCase, defragment)
+{
+  CPUAllocator allocator(sTopology, AllocationPolicy::Compact);
+
+  EXPECT_EQ(allocator.concentration(CPUSet("0-15")), 128);
+  EXPECT_EQ(allocator.concentration(CPUSet("1-3,5-7,9-11,13-15")), 72);
+
+  // Moving either partition next to the other frees a whole cache.
+  Move move = allocator.defragment(CPUSet("1-3,5-7,9-11,13-15"),
+                                   {CPUSet("0,8"), CPUSet("4,12")});
+  EXPECT_STREQ(move.mFrom.to_string().c_str(), "0,8");
+  EXPECT_STREQ(move.mTo.to_string().c_str(), "5,13");
+
+  // Nothing to gain if the partitions already fill whole caches.
+  EXPECT_TRUE(allocator
+                  .defragment(CPUSet("4-7,12-15"), {CPUSet("0-3,8-11")})
+                  .empty());
+}
+
+TEST(CPUAllocatorCase, preferred)
+{
+  CPUAllocator allocator(sTopology, AllocationPolicy::Linear);
+
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-15"), 2, CPUSet("8-15"))
+                   .to_string()
+                   .c_str(),
+               "8-9");
+  EXPECT_STREQ(allocator.allocate(CPUSet("0-15"), 3, CPUSet("14-15"))
+                   .to_string()
+                   .c_str(),
+               "0-2");
+  EXPECT_TRUE(allocator.allocate(CPUSet("0-1"), 3, CPUSet("0-1")).empty());
+}
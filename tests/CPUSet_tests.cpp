@@ -288,4 +288,43 @@ TEST(CPUSetCase, operator_out)
   snprintf(expected, sizeof(expected), "0,2-3,%d-%d", set.max_cpus() - 2,
            set.max_cpus() - 1);
   EXPECT_STREQ(expected, ss.str().c_str());
-}
\ No newline at end of file
+}
+
+TEST(CPUSetCase, to_mask)
+{
+  CPUSet set;
+
+  EXPECT_STREQ(set.to_mask().c_str(), "00000000");
+
+  set.set(0);
+  EXPECT_STREQ(set.to_mask().c_str(), "00000001");
+
+  set.parse("0-3,31");
+  EXPECT_STREQ(set.to_mask().c_str(), "8000000f");
+
+  set.parse("4,32,65");
+  EXPECT_STREQ(set.to_mask().c_str(), "00000002,00000001,00000010");
+}
+
+TEST(CPUSetCase, iterate)
+{
+  CPUSet set;
+
+  EXPECT_EQ(-1, set.first());
+  EXPECT_EQ(-1, set.last());
+  EXPECT_EQ(-1, set.next(-1));
+
+  set.parse("1,63-64,130");
+  EXPECT_EQ(1, set.first());
+  EXPECT_EQ(130, set.last());
+  EXPECT_EQ(1, set.next(-1));
+  EXPECT_EQ(63, set.next(1));
+  EXPECT_EQ(64, set.next(63));
+  EXPECT_EQ(130, set.next(64));
+  EXPECT_EQ(-1, set.next(130));
+  EXPECT_EQ(-1, set.next(set.max_cpus() - 1));
+
+  CPUSet mask("0-63");
+  EXPECT_EQ(2, set.count(mask));
+  EXPECT_EQ(4, set.count(set));
+}
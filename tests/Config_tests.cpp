@@ -0,0 +1,125 @@
+// Config_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Config.hpp"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <stdexcept>
+
+// Return the pool 'quiet' configured by text.
+static Pool pool(char const* text)
+{
+  std::istringstream in(std::string("[pool quiet]\n") + text);
+  Config             config;
+  config.parse(in, "test");
+  return config.pool("quiet");
+}
+
+TEST(ConfigCase, noise)
+{
+  EXPECT_TRUE(pool("").mNoise.empty());
+
+  Pool quiet = pool("quiet-watchdog  = yes\n"
+                    "vmstat-interval = 10\n"
+                    "rt-runtime      = -1\n"
+                    "timer-migration = no\n");
+  EXPECT_TRUE(quiet.mNoise.mWatchdog);
+  EXPECT_EQ(quiet.mNoise.mStatInterval, 10);
+  EXPECT_EQ(quiet.mNoise.mRTRuntime, -1);
+  EXPECT_EQ(quiet.mNoise.mTimerMigration, 0);
+
+  EXPECT_THROW(pool("vmstat-interval = 10s\n"), std::runtime_error);
+  EXPECT_THROW(pool("rt-runtime = -2\n"), std::runtime_error);
+}
+
+TEST(ConfigCase, combine_noise)
+{
+  NoiseProfile a, b;
+  a.mStatInterval   = 10;
+  a.mRTRuntime      = 950000;
+  b.mWatchdog       = true;
+  b.mStatInterval   = 5;
+  b.mTimerMigration = 1;
+
+  NoiseProfile c = a;
+  c |= b;
+  EXPECT_TRUE(c.mWatchdog);
+  EXPECT_EQ(c.mStatInterval, 10);
+  EXPECT_EQ(c.mRTRuntime, 950000);
+  EXPECT_EQ(c.mTimerMigration, 1);
+
+  // Disabling RT throttling and timer migration wins.
+  b.mRTRuntime      = -1;
+  a.mTimerMigration = 0;
+  c |= b;
+  c |= a;
+  EXPECT_EQ(c.mRTRuntime, -1);
+  EXPECT_EQ(c.mTimerMigration, 0);
+
+  NoiseProfile d(c.to_string());
+  EXPECT_EQ(d.to_string(), c.to_string());
+  EXPECT_THROW(NoiseProfile("1 2"), std::invalid_argument);
+}
+
+TEST(ConfigCase, frequency_grace)
+{
+  EXPECT_EQ(pool("").mFrequencyGrace, 0.0);
+  EXPECT_EQ(pool("frequency-grace = 2m\n").mFrequencyGrace, 120.0);
+  EXPECT_THROW(pool("frequency-grace = soon\n"), std::runtime_error);
+}
+
+TEST(ConfigCase, anti_affinity)
+{
+  std::map<std::string, std::string> rules = pool("").mAntiAffinity;
+  EXPECT_EQ(rules.size(), 2u);
+  EXPECT_EQ(rules["membw"], "node");
+  EXPECT_EQ(rules["cache"], "llc");
+
+  rules = pool("anti-affinity = cache:node, membw:none, compute:llc\n")
+              .mAntiAffinity;
+  EXPECT_EQ(rules.size(), 2u);
+  EXPECT_EQ(rules["cache"], "node");
+  EXPECT_EQ(rules["compute"], "llc");
+
+  EXPECT_THROW(pool("anti-affinity = io:node\n"), std::runtime_error);
+  EXPECT_THROW(pool("anti-affinity = membw:core\n"), std::runtime_error);
+  EXPECT_THROW(pool("anti-affinity = membw\n"), std::runtime_error);
+}
+
+TEST(ConfigCase, disjoint_pools)
+{
+  std::istringstream in("[pool a]\ncpus = 0-3\n"
+                        "[pool b]\ncpus = 4-5\n"
+                        "[pool c]\nisolate = yes\n");
+  Config             config;
+  config.parse(in, "test");
+  EXPECT_STREQ(config.pool("").mClaimed.to_string().c_str(), "0-5");
+  EXPECT_STREQ(config.pool("c").mClaimed.to_string().c_str(), "0-5");
+  EXPECT_TRUE(config.pool("a").mClaimed.empty());
+
+  std::istringstream overlap("[pool d]\ncpus = 5-6\n");
+  EXPECT_THROW(config.parse(overlap, "test"), std::runtime_error);
+}
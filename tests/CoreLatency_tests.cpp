@@ -0,0 +1,72 @@
+// CoreLatency_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "CoreLatency.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+// A topology with one node, one last level cache and 8 cores with 2 threads
+// each, in which the measurements show two groups of 4 cores.
+static CoreLatency two_groups()
+{
+  std::vector<int>    cpus = {0, 1, 2, 3, 4, 5, 6, 7};
+  std::vector<double> latency(64);
+  for (int a = 0; a < 8; ++a) {
+    for (int b = 0; b < 8; ++b)
+      latency[a * 8 + b] = (a / 4 == b / 4) ? 20e-9 : 80e-9;
+  }
+  latency[1 * 8 + 2] = latency[2 * 8 + 1] = 25e-9;
+  return CoreLatency(cpus, latency);
+}
+
+TEST(CoreLatencyCase, clusters)
+{
+  CPUTopology         topology(1, 1, 8, 2);
+  std::vector<CPUSet> clusters = two_groups().clusters(topology);
+  ASSERT_EQ(clusters.size(), 2u);
+  EXPECT_EQ(clusters[0], CPUSet("0-3,8-11"));
+  EXPECT_EQ(clusters[1], CPUSet("4-7,12-15"));
+}
+
+TEST(CoreLatencyCase, load_clusters)
+{
+  CPUTopology topology(1, 1, 8, 2);
+  EXPECT_FALSE(topology.load_clusters("cpus 0-7\n"
+                                      "cluster 0-3\n"));
+  EXPECT_EQ(topology.llc(4), CPUSet("0-15"));
+
+  EXPECT_TRUE(topology.load_clusters("# runexcl topology cache\n"
+                                     "cpus 0-15\n"
+                                     "cluster 0-3,8-11\n"
+                                     "cluster 4-5,12-13\n"
+                                     "latency 0 1 20\n"));
+  EXPECT_EQ(topology.llc(9), CPUSet("0-3,8-11"));
+  EXPECT_EQ(topology.llc(4), CPUSet("4-5,12-13"));
+  EXPECT_EQ(topology.llc(6), CPUSet("6-7,14-15"));
+  EXPECT_EQ(topology.order().front(), 0);
+
+  EXPECT_THROW(topology.load_clusters("cluster\n"), std::invalid_argument);
+}
@@ -0,0 +1,80 @@
+// LoadMonitor_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "LoadMonitor.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+TEST(LoadMonitorCase, parse_pressure)
+{
+  std::string pressure =
+      "some avg10=12.50 avg60=3.00 avg300=1.00 total=123456\n"
+      "full avg10=0.00 avg60=0.00 avg300=0.00 total=789\n";
+  EXPECT_EQ(LoadMonitor::parse_pressure(pressure, "some"), 123456.0);
+  EXPECT_EQ(LoadMonitor::parse_pressure(pressure, "full"), 789.0);
+  EXPECT_THROW(LoadMonitor::parse_pressure("", "some"),
+               std::invalid_argument);
+}
+
+TEST(LoadMonitorCase, parse_run_delay)
+{
+  std::string schedstat = "version 15\n"
+                          "timestamp 4295894461\n"
+                          "cpu0 0 0 10 5 3 1 1000 200 7\n"
+                          "domain0 00000003 1 2 3\n"
+                          "cpu1 0 0 10 5 3 1 1000 300 7\n"
+                          "cpu2 0 0 10 5 3 1 1000 400 7\n";
+  EXPECT_EQ(LoadMonitor::parse_run_delay(schedstat, CPUSet("1-2")), 700.0);
+  EXPECT_EQ(LoadMonitor::parse_run_delay(schedstat, CPUSet("3")), 0.0);
+}
+
+TEST(LoadMonitorCase, load)
+{
+  LoadMonitor::Sample from, to;
+  from.mTime     = 10.0;
+  from.mRunDelay = 1e9;
+  to.mTime       = 12.0;
+  to.mThreads    = 64;
+  to.mRunDelay   = 1e9 + 4 * 2 * 15e9; // 15 threads waiting on each CPU
+  Load load      = LoadMonitor::load(from, to, 4);
+  EXPECT_EQ(load.mThreads, 64);
+  EXPECT_DOUBLE_EQ(load.mWaiting, 15.0);
+  EXPECT_FALSE(load.mPressure);
+  EXPECT_TRUE(load.oversubscribed(4));
+  EXPECT_FALSE(load.oversubscribed(64));
+
+  from.mPressure = to.mPressure = true;
+  to.mSome                      = 1.5e6;
+  to.mFull                      = 0.2e6;
+  to.mRunDelay                  = from.mRunDelay;
+  load                          = LoadMonitor::load(from, to, 4);
+  EXPECT_DOUBLE_EQ(load.mSome, 75.0);
+  EXPECT_DOUBLE_EQ(load.mFull, 10.0);
+  EXPECT_TRUE(load.oversubscribed(4));
+
+  to.mSome = 0.5e6;
+  EXPECT_FALSE(LoadMonitor::load(from, to, 4).oversubscribed(4));
+}
@@ -0,0 +1,126 @@
+// Quota_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Quota.hpp"
+#include "parse.hpp"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <stdexcept>
+
+// Return a configuration with quotas for user 1000 and groups 100 and 200.
+static Config config()
+{
+  std::istringstream in("[user 1000]\n"
+                        "max-cpus = 8\n"
+                        "[group 100]\n"
+                        "max-cpus     = 2\n"
+                        "max-isolated = 0\n"
+                        "frequency    = min\n"
+                        "[group 200]\n"
+                        "max-cpus  = 4\n"
+                        "frequency = nonlinear, fixed\n"
+                        "[user *]\n"
+                        "max-cpus  = 1\n"
+                        "frequency = none\n");
+  Config             config;
+  config.parse(in, "test");
+  return config;
+}
+
+TEST(QuotaCase, lookup)
+{
+  Config const cfg = config();
+
+  Quota root(cfg, 0, {100});
+  EXPECT_TRUE(root.unlimited());
+
+  Quota user(cfg, 1000, {100});
+  EXPECT_EQ(user.mCPUs, 8);
+  EXPECT_EQ(user.mIsolated, -1);
+  EXPECT_EQ(user.mFrequencyModes, (unsigned)Quota::FrequencyAny);
+
+  // The most generous limits of all groups apply.
+  Quota member(cfg, 1001, {100, 200});
+  EXPECT_EQ(member.mCPUs, 4);
+  EXPECT_EQ(member.mIsolated, -1);
+  EXPECT_EQ(member.mFrequencyModes,
+            (unsigned)(Quota::FrequencyMin | Quota::FrequencyNonlinear |
+                       Quota::FrequencyFixed));
+
+  Quota other(cfg, 1002, {300});
+  EXPECT_EQ(other.mCPUs, 1);
+  EXPECT_EQ(other.mFrequencyModes, 0u);
+}
+
+TEST(QuotaCase, check)
+{
+  Quota quota(config(), 1001, {100});
+  Usage usage;
+
+  EXPECT_NO_THROW(quota.check(usage, 2, false));
+  EXPECT_THROW(quota.check(usage, 3, false), std::runtime_error);
+  EXPECT_THROW(quota.check(usage, 1, true), std::runtime_error);
+  usage.mCPUs = 1;
+  EXPECT_NO_THROW(quota.check(usage, 1, false));
+  EXPECT_THROW(quota.check(usage, 2, false), std::runtime_error);
+
+  EXPECT_NO_THROW(quota.check_frequency(0.0));
+  EXPECT_NO_THROW(quota.check_frequency(FREQUENCY_MIN));
+  EXPECT_THROW(quota.check_frequency(FREQUENCY_MAX), std::runtime_error);
+  EXPECT_THROW(quota.check_frequency(2e9), std::runtime_error);
+}
+
+TEST(QuotaCase, invalid)
+{
+  for (char const* value : {"4abc", "", "-2", "1.5"}) {
+    std::istringstream in(std::string("[user 1000]\nmax-cpus = ") + value +
+                          "\n");
+    Config             cfg;
+    cfg.parse(in, "test");
+    EXPECT_THROW(Quota(cfg, 1000, {}), std::runtime_error) << value;
+  }
+}
+
+TEST(QuotaCase, permissions)
+{
+  std::istringstream in("[group 100]\n"
+                        "net-queues = no\n"
+                        "boost      = no\n"
+                        "[group 200]\n"
+                        "net-queues = yes\n");
+  Config             cfg;
+  cfg.parse(in, "test");
+
+  Quota denied(cfg, 1000, {100});
+  EXPECT_FALSE(denied.unlimited());
+  EXPECT_THROW(denied.check_net_queues(), std::runtime_error);
+  EXPECT_THROW(denied.check_boost(), std::runtime_error);
+
+  // Any group permitting it is sufficient.
+  Quota member(cfg, 1000, {100, 200});
+  EXPECT_NO_THROW(member.check_net_queues());
+  EXPECT_NO_THROW(member.check_boost());
+}
@@ -0,0 +1,74 @@
+// Reservation_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "Reservation.hpp"
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <stdexcept>
+
+TEST(ReservationCase, parse)
+{
+  Reservations reservations("1 1000 100 200 0-3\n"
+                            "2 1001 150 300 4,6\n");
+  ASSERT_EQ(reservations.reservations().size(), 2u);
+  EXPECT_EQ(reservations.reservations()[1].mPID, 2);
+  EXPECT_EQ(reservations.reservations()[1].mUID, 1001u);
+  EXPECT_EQ(reservations.reservations()[1].mStart, 150);
+  EXPECT_EQ(reservations.reservations()[1].mEnd, 300);
+  EXPECT_EQ(reservations.reservations()[1].mCPUs, CPUSet("4,6"));
+  EXPECT_EQ(reservations.to_string(), "1 1000 100 200 0-3\n"
+                                      "2 1001 150 300 4,6\n");
+
+  EXPECT_TRUE(Reservations("").reservations().empty());
+  EXPECT_THROW(Reservations("1 1000 100"), std::invalid_argument);
+}
+
+TEST(ReservationCase, reserved)
+{
+  Reservations reservations("1 1000 100 200 0-3\n"
+                            "2 1001 150 300 4,6\n");
+  EXPECT_EQ(reservations.reserved(0, 100), CPUSet());
+  EXPECT_EQ(reservations.reserved(0, 101), CPUSet("0-3"));
+  EXPECT_EQ(reservations.reserved(160, 170), CPUSet("0-4,6"));
+  EXPECT_EQ(reservations.reserved(160, 170, 2), CPUSet("0-3"));
+  EXPECT_EQ(reservations.reserved(200, 400), CPUSet("4,6"));
+  EXPECT_EQ(reservations.reserved(300, 400), CPUSet());
+}
+
+TEST(ReservationCase, prune)
+{
+  // Our own process exists, and pid INT_MAX can't.
+  std::string  self = std::to_string(::getpid());
+  Reservations reservations(self + " 0 100 200 0\n" + self +
+                            " 0 100 300 1\n"
+                            "2147483647 0 100 300 2\n");
+  reservations.prune(200);
+  EXPECT_EQ(reservations.to_string(), self + " 0 100 300 1\n");
+
+  reservations.remove(::getpid());
+  EXPECT_TRUE(reservations.reservations().empty());
+}
@@ -0,0 +1,98 @@
+// parse_tests.cpp
+// Copyright (c) 2025-2025 Eric Doenges. All rights reserved.
+// SPDX-License-Identifier: ZLib
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+// claim that you wrote the original software. If you use this software
+// in a product, an acknowledgment in the product documentation would be
+// appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+// misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+// Eric Doenges
+// Eric.Doenges@gmx.net
+//
+
+#include "parse.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+TEST(ParseCase, frequency)
+{
+  EXPECT_DOUBLE_EQ(parse_frequency("1500000"), 1500000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("800Hz"), 800.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("1200k"), 1200000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("1200kHz"), 1200000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("2.5M"), 2500000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("2.5MHz"), 2500000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("3G"), 3000000000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("3GHz"), 3000000000.0);
+  EXPECT_DOUBLE_EQ(parse_frequency("max"), FREQUENCY_MAX);
+  EXPECT_DOUBLE_EQ(parse_frequency("min"), FREQUENCY_MIN);
+  EXPECT_DOUBLE_EQ(parse_frequency("nonlinear"), FREQUENCY_NONLINEAR);
+
+  EXPECT_THROW(parse_frequency(""), std::invalid_argument);
+  EXPECT_THROW(parse_frequency("fast"), std::invalid_argument);
+  EXPECT_THROW(parse_frequency("0"), std::invalid_argument);
+  EXPECT_THROW(parse_frequency("-1G"), std::invalid_argument);
+  EXPECT_THROW(parse_frequency("3THz"), std::invalid_argument);
+}
+
+TEST(ParseCase, boolean)
+{
+  EXPECT_TRUE(parse_bool("yes"));
+  EXPECT_TRUE(parse_bool("true"));
+  EXPECT_TRUE(parse_bool("on"));
+  EXPECT_TRUE(parse_bool("1"));
+  EXPECT_FALSE(parse_bool("no"));
+  EXPECT_FALSE(parse_bool("false"));
+  EXPECT_FALSE(parse_bool("off"));
+  EXPECT_FALSE(parse_bool("0"));
+  EXPECT_THROW(parse_bool("maybe"), std::invalid_argument);
+}
+
+TEST(ParseCase, duration)
+{
+  EXPECT_DOUBLE_EQ(parse_duration("90"), 90.0);
+  EXPECT_DOUBLE_EQ(parse_duration("1.5s"), 1.5);
+  EXPECT_DOUBLE_EQ(parse_duration("2m"), 120.0);
+  EXPECT_DOUBLE_EQ(parse_duration("1h"), 3600.0);
+  EXPECT_DOUBLE_EQ(parse_duration("1d"), 86400.0);
+  EXPECT_THROW(parse_duration(""), std::invalid_argument);
+  EXPECT_THROW(parse_duration("-1h"), std::invalid_argument);
+  EXPECT_THROW(parse_duration("1w"), std::invalid_argument);
+}
+
+TEST(ParseCase, time)
+{
+  struct tm tm = {};
+  tm.tm_year   = 125;
+  tm.tm_mon    = 5;
+  tm.tm_mday   = 1;
+  tm.tm_hour   = 12;
+  tm.tm_isdst  = -1;
+  time_t now   = ::mktime(&tm);
+
+  EXPECT_EQ(parse_time("+90", now), now + 90);
+  EXPECT_EQ(parse_time("+1h", now), now + 3600);
+  EXPECT_EQ(parse_time("@1000", now), 1000);
+  EXPECT_EQ(parse_time("13:30", now), now + 5400);
+  EXPECT_EQ(parse_time("13:30:10", now), now + 5410);
+  // Times that have passed today refer to tomorrow.
+  EXPECT_EQ(parse_time("11:00", now), now + 23 * 3600);
+  EXPECT_EQ(parse_time("2025-06-01T12:01", now), now + 60);
+  EXPECT_THROW(parse_time("noon", now), std::invalid_argument);
+  EXPECT_THROW(parse_time("12:00x", now), std::invalid_argument);
+  EXPECT_THROW(parse_time("@12x", now), std::invalid_argument);
+}